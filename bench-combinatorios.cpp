@@ -0,0 +1,288 @@
+#include "combinatorios.h"
+#include <chrono>
+#include <random>
+#include <new>
+#include <cstdlib>
+#include <sstream>
+
+// Microbenchmarks del algebra de termografos, aparte de la busqueda de Go. Las cargas se generan con una semilla fija:
+// Numbers diadicos al azar, lineas de termografos de juegos al azar (con muchos quiebres cuanto mas profundo el juego),
+// lineas sinteticas con una cantidad fija de quiebres (16, 64 y 256, cada tamanio por separado), consultas de paredes sobre
+// los termografos de juegos, GameTrees anchos y profundos, y sumas de varios juegos chicos. Por cada operacion reporta ns/op y allocations/op (contando los operator new).
+//
+// Uso: bench-combinatorios [escala=1] [semilla=1]
+
+size_t allocations = 0;
+
+// noinline: si g++ ve a la vez el malloc de new y el free de delete, avisa que no coinciden con las de la biblioteca
+__attribute__((noinline)) void *operator new(size_t size)
+{
+    allocations++;
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr) throw bad_alloc();
+    return p;
+}
+__attribute__((noinline)) void operator delete(void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept { free(p); }
+
+long long checksum = 0; // Para que el compilador no descarte los resultados
+
+template <typename F> void bench(const string &name, long long ops, F f)
+{
+    size_t allocationsBefore = allocations;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    f();
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    double allocs = double(allocations - allocationsBefore) / double(ops);
+    cout << name << string(name.size() < 48 ? 48 - name.size() : 1, ' ') << ns / double(ops) << " ns/op  " << allocs << " allocs/op" << endl;
+}
+
+Number randomNumber(mt19937_64 &rng)
+{
+    NumberInt numerator = NumberInt(rng() % (1 << 21)) - (1 << 20);
+    DenominatorExp e = DenominatorExp(rng() % 13);
+    while (e > 0 && numerator % 2 == 0) numerator /= 2, e--;
+    return Number(numerator, e);
+}
+
+GameTree integerGame(int n)
+{
+    GameTree g;
+    for (int i = 0; i < abs(n); i++)
+        g = n > 0 ? GameTree{{g}, {}} : GameTree{{}, {g}};
+    return g;
+}
+
+// Juego al azar con width opciones por lado como maximo y depth niveles; las hojas son enteros cerca de center. Las
+// opciones de Left se corren hacia arriba y las de Right hacia abajo, para que haya juegos calientes en todos los niveles
+// (si no, casi todo se enfria a numeros y las lineas quedan sin quiebres).
+GameTree randomGame(mt19937_64 &rng, int depth, int width, int center = 0)
+{
+    if (depth == 0) return integerGame(center + int(rng() % 5) - 2);
+    GameTree g;
+    int leftOptions = 1 + int(rng() % width), rightOptions = 1 + int(rng() % width);
+    for (int i = 0; i < leftOptions; i++) g.left.push_back(randomGame(rng, depth - 1, width, center + 1 + int(rng() % (2 * depth))));
+    for (int i = 0; i < rightOptions; i++) g.right.push_back(randomGame(rng, depth - 1, width, center - 1 - int(rng() % (2 * depth))));
+    return g;
+}
+
+// Linea que no termina hacia arriba, con exactamente breakpoints quiebres: la base cerca de center y los tramos de 1/4 a 2.
+// Las temperaturas quedan muy por debajo de INF hasta con 256 quiebres.
+ThermoLine syntheticLine(mt19937_64 &rng, int breakpoints, NumberInt center)
+{
+    ThermoLine line;
+    line.base = Section{scaledNumber(4 * center + NumberInt(rng() % 9) - 4, 2), SectionType(rng() % 2)};
+    line.startsUp = breakpoints % 2 == 1;
+    NumberInt t = 0;
+    for (int i = 0; i < breakpoints; i++)
+    {
+        t += 1 + NumberInt(rng() % 8);
+        line.v.push_back(scaledNumber(t, 2));
+    }
+    return line;
+}
+
+size_t countNodes(const GameTree &g)
+{
+    size_t n = 1;
+    for (const GameTree &o : g.left) n += countNodes(o);
+    for (const GameTree &o : g.right) n += countNodes(o);
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    int scale = argc >= 2 ? max(1, atoi(argv[1])) : 1;
+    mt19937_64 rng(argc >= 3 ? atoll(argv[2]) : 1);
+
+    // Numbers
+    const int NUMBERS = 1 << 16;
+    vector<Number> numbers;
+    for (int i = 0; i < NUMBERS; i++) numbers.push_back(randomNumber(rng));
+    long long rounds = 16LL * scale;
+    bench("Number +=", rounds * NUMBERS, [&]
+    {
+        for (long long r = 0; r < rounds; r++)
+        {
+            Number acc;
+            for (const Number &n : numbers) acc += n;
+            checksum += acc.numerator;
+        }
+    });
+    bench("Number <", rounds * NUMBERS, [&]
+    {
+        for (long long r = 0; r < rounds; r++)
+            for (int i = 1; i < NUMBERS; i++)
+                checksum += numbers[i-1] < numbers[i];
+    });
+    vector<pair<Section, Section> > ranges;
+    for (int i = 0; i + 1 < NUMBERS; i += 2)
+    {
+        Section a{numbers[i], SectionType(rng() % 2)}, b{numbers[i+1], SectionType(rng() % 2)};
+        if (b < a) swap(a, b);
+        if (a < b) ranges.push_back(make_pair(a, b));
+    }
+    bench("simplicityRule", rounds * (long long)ranges.size(), [&]
+    {
+        for (long long r = 0; r < rounds; r++)
+            for (const auto &range : ranges)
+                checksum += simplicityRule(range.first, range.second).numerator;
+    });
+
+    // Lineas: las paredes (ya giradas, como opciones) de termografos de juegos al azar
+    for (int depth : {2, 4})
+    {
+        const int GAMES = 256;
+        vector<ThermoGraph> graphs(GAMES);
+        size_t breakpoints = 0;
+        for (ThermoGraph &t : graphs)
+        {
+            thermograph(t, randomGame(rng, depth, 3));
+            t.left.startsUp ^= 1;
+            t.right.startsUp ^= 1;
+            breakpoints += t.left.v.size() + t.right.v.size();
+        }
+        ostringstream suffix;
+        suffix << " (depth " << depth << ", " << double(breakpoints) / (2 * GAMES) << " breakpoints/line)";
+        long long pairs = 64LL * scale * GAMES;
+        bench("takeMax" + suffix.str(), pairs, [&]
+        {
+            ThermoLine out;
+            for (long long i = 0; i < pairs; i++)
+            {
+                takeMax(out, graphs[i % GAMES].right, graphs[(i * 7 + 3) % GAMES].right);
+                checksum += out.v.size();
+            }
+        });
+        bench("takeMin" + suffix.str(), pairs, [&]
+        {
+            ThermoLine out;
+            for (long long i = 0; i < pairs; i++)
+            {
+                takeMin(out, graphs[i % GAMES].left, graphs[(i * 7 + 3) % GAMES].left);
+                checksum += out.v.size();
+            }
+        });
+        bench("merge" + suffix.str(), pairs, [&]
+        {
+            ThermoGraph out;
+            for (long long i = 0; i < pairs; i++)
+            {
+                merge(out, graphs[i % GAMES].right, graphs[(i * 7 + 3) % GAMES].left);
+                checksum += out.left.v.size();
+            }
+        });
+        
+        // Consultas de paredes (sobre los termografos sin girar)
+        vector<ThermoGraphIndex> indexes;
+        vector<const ThermoGraphIndex *> indexed;
+        for (ThermoGraph &t : graphs)
+        {
+            t.left.startsUp ^= 1;
+            t.right.startsUp ^= 1;
+            indexes.push_back(ThermoGraphIndex(t));
+        }
+        for (const ThermoGraphIndex &index : indexes) indexed.push_back(&index);
+        vector<Number> temperatures;
+        for (int i = 0; i < 64; i++) temperatures.push_back(Number(NumberInt(rng() % 256), 4));
+        long long queries = 16LL * scale * GAMES * (long long)temperatures.size();
+        bench("ThermoGraphIndex::wall" + suffix.str(), queries, [&]
+        {
+            for (long long r = 0; r < 16LL * scale; r++)
+                for (const ThermoGraphIndex &index : indexes)
+                    for (const Number &temperature : temperatures)
+                        checksum += index.wall(temperature).first.numerator;
+        });
+        bench("walls (batch)" + suffix.str(), queries, [&]
+        {
+            vector<pair<Number, Number> > out;
+            for (long long r = 0; r < 16LL * scale; r++)
+            {
+                walls(out, indexed, temperatures);
+                checksum += out.back().second.numerator;
+            }
+        });
+    }
+
+    // Lineas sinteticas: para takeMax / takeMin las dos lineas arrancan cerca (se cruzan seguido); para merge la pared
+    // izquierda arranca lo bastante a la derecha de la derecha como para que el mastil quede despues del ultimo quiebre.
+    for (int breakpoints : {16, 64, 256})
+    {
+        const int LINES = 256;
+        const NumberInt apart = 2 * breakpoints + 2; // Hasta el ultimo quiebre (temperatura <= 2 * breakpoints) cada linea se corre eso como mucho
+        vector<ThermoLine> near, left, right;
+        for (int i = 0; i < LINES; i++)
+        {
+            near.push_back(syntheticLine(rng, breakpoints, 0));
+            left.push_back(syntheticLine(rng, breakpoints, apart));
+            right.push_back(syntheticLine(rng, breakpoints, -apart));
+        }
+        string suffix = " (synthetic, " + to_string(breakpoints) + " breakpoints/line)";
+        long long pairs = 64LL * scale * LINES * 16 / breakpoints;
+        bench("takeMax" + suffix, pairs, [&]
+        {
+            ThermoLine out;
+            for (long long i = 0; i < pairs; i++)
+            {
+                takeMax(out, near[i % LINES], near[(i * 7 + 3) % LINES]);
+                checksum += out.v.size();
+            }
+        });
+        bench("takeMin" + suffix, pairs, [&]
+        {
+            ThermoLine out;
+            for (long long i = 0; i < pairs; i++)
+            {
+                takeMin(out, near[i % LINES], near[(i * 7 + 3) % LINES]);
+                checksum += out.v.size();
+            }
+        });
+        bench("merge" + suffix, pairs, [&]
+        {
+            ThermoGraph out;
+            for (long long i = 0; i < pairs; i++)
+            {
+                merge(out, left[i % LINES], right[(i * 7 + 3) % LINES]);
+                checksum += out.left.v.size();
+            }
+        });
+    }
+
+    // GameTrees completos
+    struct Shape { const char *name; int depth, width; };
+    for (const Shape &shape : {Shape{"wide", 3, 8}, Shape{"deep", 9, 2}})
+    {
+        GameTree game = randomGame(rng, shape.depth, shape.width);
+        size_t nodes = countNodes(game);
+        long long reps = 4LL * scale;
+        bench(string("thermograph(GameTree) ") + shape.name + " per node", reps * (long long)nodes, [&]
+        {
+            for (long long r = 0; r < reps; r++)
+            {
+                ThermoGraph t;
+                thermograph(t, game);
+                checksum += t.mast().numerator;
+            }
+        });
+    }
+
+    // Sumas de varios componentes chicos, sin armar el arbol de la suma
+    for (int count : {2, 3, 4})
+    {
+        vector<GameTree> components;
+        for (int i = 0; i < count; i++) components.push_back(randomGame(rng, 3, 2));
+        long long reps = 4LL * scale;
+        bench("sumThermograph " + to_string(count) + " components (depth 3)", reps, [&]
+        {
+            for (long long r = 0; r < reps; r++)
+            {
+                ThermoGraph t;
+                sumThermograph(t, components);
+                checksum += t.mast().numerator;
+            }
+        });
+    }
+
+    cerr << "checksum " << checksum << endl;
+    return 0;
+}
@@ -1,6 +1,13 @@
+#pragma once
 #include <iostream>
 #include <vector>
 #include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include <atomic>
+#include <future>
+#include <thread>
 
 using namespace std;
 
@@ -68,7 +75,7 @@ struct Number
     NumberInt denom() const {return 1LL << denominatorExp;}
 };
 
-ostream &operator<<(ostream & os, const Number &number)
+inline ostream &operator<<(ostream & os, const Number &number)
 {
     if (number.denominatorExp == 0) os << number.numerator;
     else if (number.numerator == 0) os << 0;
@@ -93,7 +100,7 @@ struct Section
     
 };
 
-Number simplicityRule(Section a, Section b)
+inline Number simplicityRule(Section a, Section b)
 {
     assert(a < b);
     // El Number con menor denominador entre a y b. Si hay mas de un entero en rango, el de menor modulo.
@@ -133,14 +140,14 @@ Number simplicityRule(Section a, Section b)
     return ret;
 }
 
-Number simplicityOnlyLeftOption(Section s)
+inline Number simplicityOnlyLeftOption(Section s)
 {
     if (s.negative()) return ZERO;
     if (s.t == BELOW && s.x.isInteger()) return s.x;
     return Number(1 + (s.x.numerator >> s.x.denominatorExp));
 }
 
-Number simplicityOnlyRightOption(Section s)
+inline Number simplicityOnlyRightOption(Section s)
 {
     s.negate();
     Number x = simplicityOnlyLeftOption(s);
@@ -156,6 +163,7 @@ struct ThermoLine
     void turnLine() {startsUp ^= 1;}
     bool terminal() {return startsUp && v.empty();}
     bool operator!=(const ThermoLine &o) const { return v != o.v || base != o.base || startsUp != o.startsUp;}
+    bool operator==(const ThermoLine &o) const { return !(*this != o); }
 };
 
 struct ThermoGraph
@@ -183,7 +191,7 @@ struct ThermoGraph
     bool operator !=(const ThermoGraph &o) const { return left != o.left || right != o.right; }
 };
 
-ostream & operator<<(ostream &os, const ThermoGraph &t)
+inline ostream & operator<<(ostream &os, const ThermoGraph &t)
 {
     os << t.mast() << "(" << t.temperature() << ")";
     return os;
@@ -191,16 +199,162 @@ ostream & operator<<(ostream &os, const ThermoGraph &t)
 
 const ThermoGraph ZERO_THERMOGRAPH{{vector<Number>(), {ZERO, BELOW}, true}, {vector<Number>(), {ZERO, ABOVE}, true}};
 
-void takeMax(ThermoLine &ret, const ThermoLine &line1, const ThermoLine &line2)
+// Consultas sobre un termografo ya calculado: posicion de las paredes a una temperatura t, ancho y mastil. Cada pared
+// guarda su valor en cada quiebre, asi que evaluarla es una busqueda binaria sobre los quiebres en vez de recorrer la linea.
+// La pared izquierda resta la temperatura en los tramos inclinados y la derecha la suma (como en ThermoGraph::mast()).
+
+struct ThermoLineIndex
+{
+    vector<Number> t;     // Quiebres de la linea
+    vector<Number> value; // value[i]: valor de la linea en t[i-1] (value[0] en temperatura cero)
+    bool startsUp;
+    bool subtracts;       // true para la pared izquierda
+    
+    ThermoLineIndex() {}
+    ThermoLineIndex(const ThermoLine &line, bool left) : t(line.v), startsUp(line.startsUp), subtracts(left)
+    {
+        value.push_back(line.base.x);
+        Number currentT;
+        bool up = startsUp;
+        for (const Number &nextT : t)
+        {
+            Number x = value.back();
+            if (!up) slide(x, currentT, nextT);
+            value.push_back(x);
+            currentT = nextT;
+            up ^= 1;
+        }
+    }
+    
+    void slide(Number &x, const Number &from, const Number &to) const
+    {
+        if (subtracts) { x += from; x -= to; }
+        else { x += to; x -= from; }
+    }
+    
+    // Valor en temperatura, sabiendo que hay exactamente k quiebres <= temperatura
+    Number at(const Number &temperature, size_t k) const
+    {
+        Number x = value[k];
+        if ((k % 2 == 0) != startsUp) slide(x, k == 0 ? ZERO : t[k-1], temperature);
+        return x;
+    }
+    
+    Number at(const Number &temperature) const
+    {
+        return at(temperature, size_t(upper_bound(t.begin(), t.end(), temperature) - t.begin()));
+    }
+    
+    Number top() const { return value.back(); } // Valor por encima del ultimo quiebre (la linea ya es vertical)
+};
+
+struct ThermoGraphIndex
+{
+    ThermoLineIndex left, right;
+    Number mast, temperature;
+    
+    ThermoGraphIndex() {}
+    explicit ThermoGraphIndex(const ThermoGraph &g) : left(g.left, true), right(g.right, false), mast(left.top()), temperature(g.temperature()) {}
+    
+    pair<Number, Number> wall(const Number &t) const { return make_pair(left.at(t), right.at(t)); }
+    Number width(const Number &t) const
+    {
+        Number w = left.at(t);
+        w -= right.at(t);
+        return w;
+    }
+};
+
+// Paredes de muchos termografos a muchas temperaturas: ret[g * temperatures.size() + j] es wall(temperatures[j]) de
+// graphs[g]. Las temperaturas se ordenan una sola vez y cada pared se recorre de abajo hacia arriba, sin busqueda binaria.
+inline void walls(vector<pair<Number, Number> > &ret, const vector<const ThermoGraphIndex *> &graphs, const vector<Number> &temperatures)
+{
+    const size_t m = temperatures.size();
+    vector<size_t> order(m);
+    for (size_t j = 0; j < m; j++) order[j] = j;
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return temperatures[a] < temperatures[b]; });
+    ret.resize(graphs.size() * m);
+    for (size_t g = 0; g < graphs.size(); g++)
+    {
+        const ThermoLineIndex &left = graphs[g]->left, &right = graphs[g]->right;
+        size_t kl = 0, kr = 0;
+        for (size_t j : order)
+        {
+            const Number &temperature = temperatures[j];
+            while (kl < left.t.size() && left.t[kl] <= temperature) kl++;
+            while (kr < right.t.size() && right.t[kr] <= temperature) kr++;
+            ret[g * m + j] = make_pair(left.at(temperature, kl), right.at(temperature, kr));
+        }
+    }
+}
+
+// Layout alternativo de una ThermoLine para los barridos: toda la linea (o el par que se combina) llevada a un mismo
+// denominador 2^e, con los quiebres como enteros contiguos. Asi los barridos comparan y suman enteros crudos en vez de
+// realinear exponentes en cada operacion de Number.
+
+struct ScaledLine
+{
+    vector<NumberInt> v;
+    NumberInt base;
+    SectionType t;
+    bool startsUp;
+    pair<NumberInt, int> section() const { return make_pair(base, int(t)); }
+    void setBase(pair<NumberInt, int> s) { base = s.first; t = SectionType(s.second); }
+};
+
+inline DenominatorExp commonExp(const ThermoLine &line)
+{
+    DenominatorExp e = line.base.x.denominatorExp;
+    for (const Number &n : line.v) e = max(e, n.denominatorExp);
+    return e;
+}
+
+// x * 2^k. Con un multiplicador y no con x << k, que es comportamiento indefinido si x es negativo.
+inline NumberInt scaleUp(NumberInt x, int k)
+{
+    return x * (NumberInt(1) << k);
+}
+
+inline void toScaled(ScaledLine &ret, const ThermoLine &line, DenominatorExp e)
+{
+    assert(e < 48); // INF * 2^e tiene que entrar holgado en un NumberInt
+    ret.base = scaleUp(line.base.x.numerator, e - line.base.x.denominatorExp);
+    ret.t = line.base.t;
+    ret.startsUp = line.startsUp;
+    const int n = (int)line.v.size();
+    ret.v.resize(n);
+    for (int i = 0; i < n; i++)
+        ret.v[i] = scaleUp(line.v[i].numerator, e - line.v[i].denominatorExp);
+}
+
+inline Number fromScaled(NumberInt x, DenominatorExp e)
+{
+    if (x == 0) return ZERO;
+    DenominatorExp shift = DenominatorExp(min<int>(e, __builtin_ctzll((unsigned long long)x)));
+    return Number(x / (NumberInt(1) << shift), DenominatorExp(e - shift)); // Exacta: x es multiplo de 2^shift
+}
+
+inline void fromScaled(ThermoLine &ret, const ScaledLine &line, DenominatorExp e)
+{
+    ret.base.x = fromScaled(line.base, e);
+    ret.base.t = line.t;
+    ret.startsUp = line.startsUp;
+    const int n = (int)line.v.size();
+    ret.v.resize(n);
+    for (int i = 0; i < n; i++)
+        ret.v[i] = fromScaled(line.v[i], e);
+}
+
+inline void takeMaxScaled(ScaledLine &ret, const ScaledLine &line1, const ScaledLine &line2, const NumberInt inf)
 {
     // line1 y line2 son leftLines (suben y "restan" [A la derecha en termografo])
     ret.v.clear();
     ret.v.reserve(line1.v.size() + line2.v.size() + 1);
     
-    Number A = line1.base.x,B = line2.base.x;
+    NumberInt A = line1.base,B = line2.base;
     bool aUp = line1.startsUp;
     bool bUp = line2.startsUp;
-    Number C; bool cUp;
+    NumberInt C; bool cUp;
     if (A < B)
     {
         cUp = bUp;
@@ -217,25 +371,25 @@ void takeMax(ThermoLine &ret, const ThermoLine &line1, const ThermoLine &line2)
         C = A;
     }
     ret.startsUp = cUp;
-    ret.base = max(line1.base, line2.base);
-    Number currentT; // Starts from temperature zero and up
+    ret.setBase(max(line1.section(), line2.section()));
+    NumberInt currentT = 0; // Starts from temperature zero and up
+    const NumberInt *v1 = line1.v.data(), *v2 = line2.v.data();
+    const int n1 = (int)line1.v.size(), n2 = (int)line2.v.size();
     int i=0,j=0;
-    while (i < (int)line1.v.size() || j < (int)line2.v.size())
+    while (i < n1 || j < n2)
     {
         assert(A <= C);
         assert(B <= C);
         assert((A == C && aUp == cUp) || (B == C && bUp == cUp));
         assert(A != B || cUp == (aUp || bUp));
-        const Number nextT1 = (i < (int)line1.v.size()) ? line1.v[i] : INF;
-        const Number nextT2 = (j < (int)line2.v.size()) ? line2.v[j] : INF;
-        const Number nextT =  min(nextT1, nextT2);
+        const NumberInt nextT1 = (i < n1) ? v1[i] : inf;
+        const NumberInt nextT2 = (j < n2) ? v2[j] : inf;
+        const NumberInt nextT = min(nextT1, nextT2);
         if ((aUp || bUp) && !cUp)
         {
-            const Number upCoord = aUp ? A : B;
+            const NumberInt upCoord = aUp ? A : B;
             assert(upCoord < C);
-            Number colisionT = currentT;
-            colisionT += C;
-            colisionT -= upCoord;
+            const NumberInt colisionT = currentT + C - upCoord;
             if (colisionT < nextT)
             {
                 ret.v.push_back(colisionT);
@@ -245,8 +399,7 @@ void takeMax(ThermoLine &ret, const ThermoLine &line1, const ThermoLine &line2)
             }
         }
         
-        Number delta = nextT;
-        delta -= currentT;
+        const NumberInt delta = nextT - currentT;
         if (!aUp) A -= delta;
         if (!bUp) B -= delta;
         
@@ -292,16 +445,16 @@ void takeMax(ThermoLine &ret, const ThermoLine &line1, const ThermoLine &line2)
     }
 }
 
-void takeMin(ThermoLine &ret, const ThermoLine &line1, const ThermoLine &line2)
+inline void takeMinScaled(ScaledLine &ret, const ScaledLine &line1, const ScaledLine &line2, const NumberInt inf)
 {
     // line1 y line2 son rightLines (suben y "suman" [A la izquierda en termografo])
     ret.v.clear();
     ret.v.reserve(line1.v.size() + line2.v.size() + 1);
     
-    Number A = line1.base.x,B = line2.base.x;
+    NumberInt A = line1.base,B = line2.base;
     bool aUp = line1.startsUp;
     bool bUp = line2.startsUp;
-    Number C; bool cUp;
+    NumberInt C; bool cUp;
     if (A < B)
     {
         cUp = aUp;
@@ -318,25 +471,25 @@ void takeMin(ThermoLine &ret, const ThermoLine &line1, const ThermoLine &line2)
         C = A;
     }
     ret.startsUp = cUp;
-    ret.base = min(line1.base, line2.base);
-    Number currentT; // Starts from temperature zero and up
+    ret.setBase(min(line1.section(), line2.section()));
+    NumberInt currentT = 0; // Starts from temperature zero and up
+    const NumberInt *v1 = line1.v.data(), *v2 = line2.v.data();
+    const int n1 = (int)line1.v.size(), n2 = (int)line2.v.size();
     int i=0,j=0;
-    while (i < (int)line1.v.size() || j < (int)line2.v.size())
+    while (i < n1 || j < n2)
     {
         assert(C <= A);
         assert(C <= B);
         assert((A == C && aUp == cUp) || (B == C && bUp == cUp));
         assert(A != B || cUp == (aUp || bUp));
-        const Number nextT1 = (i < (int)line1.v.size()) ? line1.v[i] : INF;
-        const Number nextT2 = (j < (int)line2.v.size()) ? line2.v[j] : INF;
-        const Number nextT =  min(nextT1, nextT2);
+        const NumberInt nextT1 = (i < n1) ? v1[i] : inf;
+        const NumberInt nextT2 = (j < n2) ? v2[j] : inf;
+        const NumberInt nextT = min(nextT1, nextT2);
         if ((aUp || bUp) && !cUp)
         {
-            const Number upCoord = aUp ? A : B;
+            const NumberInt upCoord = aUp ? A : B;
             assert(C < upCoord);
-            Number colisionT = currentT;
-            colisionT += upCoord;
-            colisionT -= C;
+            const NumberInt colisionT = currentT + upCoord - C;
             if (colisionT < nextT)
             {
                 ret.v.push_back(colisionT);
@@ -346,8 +499,7 @@ void takeMin(ThermoLine &ret, const ThermoLine &line1, const ThermoLine &line2)
             }
         }
         
-        Number delta = nextT;
-        delta -= currentT;
+        const NumberInt delta = nextT - currentT;
         if (!aUp) A += delta;
         if (!bUp) B += delta;
         
@@ -393,7 +545,30 @@ void takeMin(ThermoLine &ret, const ThermoLine &line1, const ThermoLine &line2)
     }
 }
 
-void mergeOnlyLeft(ThermoGraph &ret, const ThermoLine &leftLine)
+// Buffers reutilizables para no alocar en cada combinacion.
+inline thread_local ScaledLine scaledA, scaledB, scaledC, scaledD;
+
+inline void takeMax(ThermoLine &ret, const ThermoLine &line1, const ThermoLine &line2)
+{
+    // line1 y line2 son leftLines (suben y "restan" [A la derecha en termografo])
+    DenominatorExp e = max(commonExp(line1), commonExp(line2));
+    toScaled(scaledA, line1, e);
+    toScaled(scaledB, line2, e);
+    takeMaxScaled(scaledC, scaledA, scaledB, scaleUp(INF.numerator, e));
+    fromScaled(ret, scaledC, e);
+}
+
+inline void takeMin(ThermoLine &ret, const ThermoLine &line1, const ThermoLine &line2)
+{
+    // line1 y line2 son rightLines (suben y "suman" [A la izquierda en termografo])
+    DenominatorExp e = max(commonExp(line1), commonExp(line2));
+    toScaled(scaledA, line1, e);
+    toScaled(scaledB, line2, e);
+    takeMinScaled(scaledC, scaledA, scaledB, scaleUp(INF.numerator, e));
+    fromScaled(ret, scaledC, e);
+}
+
+inline void mergeOnlyLeft(ThermoGraph &ret, const ThermoLine &leftLine)
 {
     ThermoLine &leftRet = ret.left;
     ThermoLine &rightRet = ret.right;
@@ -403,7 +578,7 @@ void mergeOnlyLeft(ThermoGraph &ret, const ThermoLine &leftLine)
     leftRet.v.clear(); rightRet.v.clear();
 }
 
-void mergeOnlyRight(ThermoGraph &ret, const ThermoLine &rightLine)
+inline void mergeOnlyRight(ThermoGraph &ret, const ThermoLine &rightLine)
 {
     ThermoLine &leftRet = ret.left;
     ThermoLine &rightRet = ret.right;
@@ -413,7 +588,89 @@ void mergeOnlyRight(ThermoGraph &ret, const ThermoLine &rightLine)
     leftRet.v.clear(); rightRet.v.clear();
 }
 
-void merge(ThermoGraph &ret, const ThermoLine &leftLine, const ThermoLine &rightLine)
+inline void mergeScaled(ScaledLine &leftRet, ScaledLine &rightRet, const ScaledLine &leftLine, const ScaledLine &rightLine, const NumberInt inf)
+{
+    // Se asume: leftLine.base > rightLine.base, y que ninguna de las dos termina hacia arriba
+    NumberInt A = leftLine.base,B = rightLine.base;
+    // Copiar pero con un espacio extra al final que tenga un +INF ("explicitamos" la representacion que lo lleva implicito)
+    leftRet .v.resize(1 + leftLine .v.size());
+    rightRet.v.resize(1 + rightLine.v.size());
+    for (int i = 0; i < (int)leftLine.v.size(); i++)
+        leftRet.v[i] = leftLine.v[i];
+    for (int j = 0; j < (int)rightLine.v.size(); j++)
+        rightRet.v[j] = rightLine.v[j];
+    leftRet.v.back() = inf;
+    rightRet.v.back() = inf;
+    leftRet .base = leftLine .base; leftRet .t = leftLine .t;
+    rightRet.base = rightLine.base; rightRet.t = rightLine.t;
+    leftRet .startsUp = leftLine.startsUp;
+    rightRet.startsUp = rightLine.startsUp;
+    
+    bool aUp = leftLine.startsUp;
+    bool bUp = rightLine.startsUp;
+    NumberInt currentT = 0; // Starts from temperature zero and up
+    int i=0,j=0;
+    while (true)
+    {
+        // Invariante: A > B
+        const NumberInt nL = leftRet.v[i];
+        const NumberInt nR = rightRet.v[j];
+        const NumberInt nextT = min(nL, nR);
+        const NumberInt delta = nextT - currentT;
+        if (!aUp) A -= delta;
+        if (!bUp) B += delta;
+        if (A <= B)
+        {
+            if (!aUp) A += delta;
+            if (!bUp) B -= delta;
+            break; // Encontramos el mastil
+        }
+        
+        if (nL < nR)
+        {
+            i++;
+            aUp ^= 1;
+        }
+        else if (nR < nL)
+        {
+            j++;
+            bUp ^= 1;
+        }
+        else
+        {
+            i++;
+            j++;
+            aUp ^= 1;
+            bUp ^= 1;
+        }
+        currentT = nextT;
+    }
+    // Calcular y agregar mastil + ultimos tramos (si existen porque no es "aUp" o "bUp"), y listo
+    assert(B < A);
+    assert(!(aUp && bUp));
+    A -= B;
+    if (aUp)
+    {
+        currentT += A;
+        rightRet.v[j++] = currentT;
+    }
+    else if (bUp)
+    {
+        currentT += A;
+        leftRet.v[i++] = currentT;
+    }
+    else 
+    {
+        assert(A % 2 == 0);
+        currentT += A / 2;
+        leftRet .v[i++] = currentT;
+        rightRet.v[j++] = currentT;
+    }
+    leftRet.v.resize(i);
+    rightRet.v.resize(j);
+}
+
+inline void merge(ThermoGraph &ret, const ThermoLine &leftLine, const ThermoLine &rightLine)
 {
     // Se asume: leftLine termina hacia la derecha, rightLine termina hacia la izquierda (ninguna hacia arriba)
     ThermoLine &leftRet = ret.left;
@@ -435,85 +692,312 @@ void merge(ThermoGraph &ret, const ThermoLine &leftLine, const ThermoLine &right
     }
     else
     {
-        // Copiar pero con un espacio extra al final que tenga un +INF ("explicitamos" la representacion que lo lleva implicito)
-        leftRet .v.resize(1 + leftLine .v.size());
-        rightRet.v.resize(1 + rightLine.v.size());
-        for (int i = 0; i < (int)leftLine.v.size(); i++)
-            leftRet.v[i] = leftLine.v[i];
-        for (int j = 0; j < (int)rightLine.v.size(); j++)
-            rightRet.v[j] = rightLine.v[j];
-        leftRet.v.back() = INF;
-        rightRet.v.back() = INF;
-        leftRet .base = leftLine .base;
-        rightRet.base = rightLine.base;
-        leftRet .startsUp = leftLine.startsUp;
-        rightRet.startsUp = rightLine.startsUp;
-        
-        bool aUp = leftLine.startsUp;
-        bool bUp = rightLine.startsUp;
-        Number currentT; // Starts from temperature zero and up
-        int i=0,j=0;
-        while (true)
-        {
-            // Invariante: A > B
-            const Number &nL = leftRet.v[i];
-            const Number &nR = rightRet.v[j];
-            const Number nextT = min(nL, nR);
-            Number delta = nextT;
-            delta -= currentT;
-            if (!aUp) A -= delta;
-            if (!bUp) B += delta;
-            if (A <= B)
-            {
-                if (!aUp) A += delta;
-                if (!bUp) B -= delta;
-                break; // Encontramos el mastil
-            }
-            
-            if (nL < nR)
-            {
-                i++;
-                aUp ^= 1;
-            }
-            else if (nR < nL)
-            {
-                j++;
-                bUp ^= 1;
-            }
-            else
-            {
-                i++;
-                j++;
-                aUp ^= 1;
-                bUp ^= 1;
-            }
-            currentT = nextT;
+        // Todo a un mismo denominador, con un bit extra porque el mastil puede caer en la mitad del ultimo tramo
+        DenominatorExp e = DenominatorExp(1 + max(commonExp(leftLine), commonExp(rightLine)));
+        toScaled(scaledA, leftLine, e);
+        toScaled(scaledB, rightLine, e);
+        mergeScaled(scaledC, scaledD, scaledA, scaledB, scaleUp(INF.numerator, e));
+        fromScaled(leftRet, scaledC, e);
+        fromScaled(rightRet, scaledD, e);
+    }
+}
+
+// Codificacion compacta de una ThermoLine: un byte con startsUp, base.t y un exponente comun E, y luego varints (zigzag)
+// con todos los numeradores llevados a denominador 2^E: la base, la cantidad de quiebres y los quiebres como diferencias.
+
+inline void putVarint(vector<unsigned char> &out, long long x)
+{
+    unsigned long long z = ((unsigned long long)x << 1) ^ (unsigned long long)(x >> 63);
+    while (z >= 128) { out.push_back((unsigned char)(z | 128)); z >>= 7; }
+    out.push_back((unsigned char)z);
+}
+
+inline long long getVarint(const unsigned char *&in)
+{
+    unsigned long long z = 0;
+    for (int shift = 0; ; shift += 7)
+    {
+        unsigned char b = *in++;
+        z |= (unsigned long long)(b & 127) << shift;
+        if (b < 128) break;
+    }
+    return (long long)(z >> 1) ^ -(long long)(z & 1);
+}
+
+inline void encodeLine(const ThermoLine &l, vector<unsigned char> &out)
+{
+    DenominatorExp e = l.base.x.denominatorExp;
+    for (const Number &n : l.v) e = max(e, n.denominatorExp);
+    assert(e < 64);
+    out.push_back((unsigned char)((e << 2) | (l.base.t << 1) | l.startsUp));
+    putVarint(out, scaleUp(l.base.x.numerator, e - l.base.x.denominatorExp));
+    putVarint(out, (long long)l.v.size());
+    NumberInt previous = 0;
+    for (const Number &n : l.v)
+    {
+        NumberInt x = scaleUp(n.numerator, e - n.denominatorExp);
+        putVarint(out, x - previous);
+        previous = x;
+    }
+}
+
+inline Number scaledNumber(NumberInt numerator, DenominatorExp e)
+{
+    while (e > 0 && numerator % 2 == 0) numerator /= 2, e--;
+    return Number(numerator, e);
+}
+
+// Devuelve el puntero al primer byte despues de la linea.
+inline const unsigned char *decodeLine(const unsigned char *in, ThermoLine &l)
+{
+    unsigned char header = *in++;
+    DenominatorExp e = DenominatorExp(header >> 2);
+    l.startsUp = header & 1;
+    l.base.t = SectionType((header >> 1) & 1);
+    l.base.x = scaledNumber(getVarint(in), e);
+    l.v.resize((size_t)getVarint(in));
+    NumberInt x = 0;
+    for (Number &n : l.v)
+    {
+        x += getVarint(in);
+        n = scaledNumber(x, e);
+    }
+    return in;
+}
+
+// Slot de tamanio fijo para una linea codificada: si entra, va inline; si no, el slot apunta al area de desborde (spill).
+struct PackedLine
+{
+    static const int INLINE_BYTES = 15;
+    unsigned char size; // Bytes de la codificacion, o SPILLED
+    unsigned char bytes[INLINE_BYTES]; // Codificacion inline, o bien offset y largo (unsigned int) en el spill
+    static const unsigned char SPILLED = 255;
+};
+
+// Bytes por categoria, para saber cuanto ocupa una busqueda. Son estimaciones de lo reservado por cada estructura
+// (capacidad de los vectores, nodos y buckets de las tablas hash), no de lo que malloc le pidio al sistema.
+struct MemoryReport
+{
+    vector<pair<string, size_t> > categories;
+    void add(const string &name, size_t bytes) { categories.push_back(make_pair(name, bytes)); }
+    size_t total() const
+    {
+        size_t ret = 0;
+        for (const auto &c : categories) ret += c.second;
+        return ret;
+    }
+};
+
+inline ostream &operator<<(ostream &os, const MemoryReport &r)
+{
+    for (const auto &c : r.categories)
+        os << "    " << c.first << ": " << c.second << " bytes" << endl;
+    os << "    total: " << r.total() << " bytes" << endl;
+    return os;
+}
+
+// Cada elemento de una tabla hash de la biblioteca estandar es un nodo (puntero al siguiente y el par) pedido a malloc,
+// que le suma 8 bytes y redondea a 16 (32 como minimo); ademas hay un puntero por bucket.
+template <typename Map> size_t hashTableBytes(const Map &m)
+{
+    size_t node = max<size_t>(32, (sizeof(void *) + sizeof(typename Map::value_type) + 8 + 15) / 16 * 16);
+    return m.size() * node + m.bucket_count() * sizeof(void *);
+}
+
+// Pool de termografos "internados": cada ThermoLine / ThermoGraph distinto se guarda una sola vez y se identifica por un id
+// de 32 bits. Las operaciones sobre ids (takeMax, takeMin, merge...) se memorizan por los ids de los operandos.
+
+typedef unsigned int LineId;
+typedef unsigned int GraphId;
+
+struct ThermoPool
+{
+    vector<PackedLine> lines;
+    vector<unsigned char> spill;
+    vector<unsigned char> scratch; // Buffer para codificar la linea a internar
+    vector<LineId> graphLeft, graphRight;
+    unordered_multimap<size_t, LineId> lineIndex; // hash de la linea -> lineas con ese hash
+    unordered_map<unsigned long long, GraphId> graphIndex;
+    unordered_map<unsigned long long, LineId> maxMemo, minMemo, turnMemo;
+    unordered_map<unsigned long long, GraphId> mergeMemo;
+    unordered_map<LineId, GraphId> onlyLeftMemo, onlyRightMemo;
+    GraphId zero;
+    
+    ThermoPool() { zero = intern(ZERO_THERMOGRAPH); }
+    
+    static unsigned long long key(unsigned int a, unsigned int b) { return ((unsigned long long)a << 32) | b; }
+    
+    const unsigned char *encoded(LineId id, unsigned int &size) const
+    {
+        const PackedLine &p = lines[id];
+        if (p.size != PackedLine::SPILLED)
+        {
+            size = p.size;
+            return p.bytes;
         }
-        // Calcular y agregar mastil + ultimos tramos (si existen porque no es "aUp" o "bUp"), y listo
-        assert(B < A);
-        assert(!(aUp && bUp));
-        A -= B;
-        if (aUp)
+        unsigned int offset;
+        memcpy(&offset, p.bytes, sizeof(offset));
+        memcpy(&size, p.bytes + sizeof(offset), sizeof(size));
+        return spill.data() + offset;
+    }
+    
+    // Las lineas se guardan codificadas y se decodifican recien cuando se las pide.
+    void line(LineId id, ThermoLine &out) const
+    {
+        unsigned int size;
+        decodeLine(encoded(id, size), out);
+    }
+    ThermoLine line(LineId id) const { ThermoLine l; line(id, l); return l; }
+    LineId left (GraphId id) const { return graphLeft[id]; }
+    LineId right(GraphId id) const { return graphRight[id]; }
+    ThermoGraph graph(GraphId id) const { return ThermoGraph{line(graphLeft[id]), line(graphRight[id])}; }
+    size_t lineCount () const { return lines.size(); }
+    size_t graphCount() const { return graphLeft.size(); }
+    
+    LineId intern(const ThermoLine &l)
+    {
+        scratch.clear();
+        encodeLine(l, scratch);
+        size_t h = scratch.size();
+        for (unsigned char b : scratch) h = h * 1000003 + b;
+        auto range = lineIndex.equal_range(h);
+        for (auto it = range.first; it != range.second; ++it)
         {
-            currentT += A;
-            rightRet.v[j++] = currentT;
+            unsigned int size;
+            const unsigned char *bytes = encoded(it->second, size);
+            if (size == scratch.size() && memcmp(bytes, scratch.data(), size) == 0)
+                return it->second;
         }
-        else if (bUp)
+        LineId id = LineId(lines.size());
+        PackedLine p;
+        if (scratch.size() <= PackedLine::INLINE_BYTES)
         {
-            currentT += A;
-            leftRet.v[i++] = currentT;
+            p.size = (unsigned char)scratch.size();
+            memcpy(p.bytes, scratch.data(), scratch.size());
         }
-        else 
+        else
         {
-            A.halve();
-            currentT += A;
-            leftRet .v[i++] = currentT;
-            rightRet.v[j++] = currentT;
+            p.size = PackedLine::SPILLED;
+            unsigned int offset = (unsigned int)spill.size(), size = (unsigned int)scratch.size();
+            memcpy(p.bytes, &offset, sizeof(offset));
+            memcpy(p.bytes + sizeof(offset), &size, sizeof(size));
+            spill.insert(spill.end(), scratch.begin(), scratch.end());
         }
-        leftRet.v.resize(i);
-        rightRet.v.resize(j);
+        lines.push_back(p);
+        lineIndex.emplace(h, id);
+        return id;
     }
-}
+    
+    GraphId intern(LineId l, LineId r)
+    {
+        auto it = graphIndex.find(key(l, r));
+        if (it != graphIndex.end()) return it->second;
+        GraphId id = GraphId(graphLeft.size());
+        graphLeft.push_back(l);
+        graphRight.push_back(r);
+        graphIndex[key(l, r)] = id;
+        return id;
+    }
+    
+    GraphId intern(const ThermoGraph &t) { return intern(intern(t.left), intern(t.right)); }
+    
+    // La linea desplazada en "shift" puntos y con startsUp invertido: lo que se hace con la linea de una opcion antes de combinarla.
+    LineId turn(LineId id, int shift)
+    {
+        auto it = turnMemo.find(key(id, (unsigned int)shift));
+        if (it != turnMemo.end()) return it->second;
+        ThermoLine l = line(id);
+        l.base.x += Number(shift);
+        l.turnLine();
+        LineId ret = intern(l);
+        turnMemo[key(id, (unsigned int)shift)] = ret;
+        return ret;
+    }
+    
+    // takeMax y takeMin son simetricas, asi que la clave usa los ids ordenados.
+    LineId takeMax(LineId a, LineId b)
+    {
+        if (a == b) return a;
+        if (b < a) swap(a, b);
+        auto it = maxMemo.find(key(a, b));
+        if (it != maxMemo.end()) return it->second;
+        ThermoLine l;
+        ::takeMax(l, line(a), line(b));
+        LineId ret = intern(l);
+        maxMemo[key(a, b)] = ret;
+        return ret;
+    }
+    
+    LineId takeMin(LineId a, LineId b)
+    {
+        if (a == b) return a;
+        if (b < a) swap(a, b);
+        auto it = minMemo.find(key(a, b));
+        if (it != minMemo.end()) return it->second;
+        ThermoLine l;
+        ::takeMin(l, line(a), line(b));
+        LineId ret = intern(l);
+        minMemo[key(a, b)] = ret;
+        return ret;
+    }
+    
+    GraphId merge(LineId leftLine, LineId rightLine)
+    {
+        auto it = mergeMemo.find(key(leftLine, rightLine));
+        if (it != mergeMemo.end()) return it->second;
+        ThermoGraph t;
+        ::merge(t, line(leftLine), line(rightLine));
+        GraphId ret = intern(t);
+        mergeMemo[key(leftLine, rightLine)] = ret;
+        return ret;
+    }
+    
+    GraphId mergeOnlyLeft(LineId leftLine)
+    {
+        auto it = onlyLeftMemo.find(leftLine);
+        if (it != onlyLeftMemo.end()) return it->second;
+        ThermoGraph t;
+        ::mergeOnlyLeft(t, line(leftLine));
+        GraphId ret = intern(t);
+        onlyLeftMemo[leftLine] = ret;
+        return ret;
+    }
+    
+    GraphId mergeOnlyRight(LineId rightLine)
+    {
+        auto it = onlyRightMemo.find(rightLine);
+        if (it != onlyRightMemo.end()) return it->second;
+        ThermoGraph t;
+        ::mergeOnlyRight(t, line(rightLine));
+        GraphId ret = intern(t);
+        onlyRightMemo[rightLine] = ret;
+        return ret;
+    }
+    
+    void memory(MemoryReport &r) const
+    {
+        r.add("pool lines", lines.capacity() * sizeof(PackedLine) + spill.capacity() + scratch.capacity());
+        r.add("pool graphs", (graphLeft.capacity() + graphRight.capacity()) * sizeof(LineId));
+        r.add("pool index", hashTableBytes(lineIndex) + hashTableBytes(graphIndex));
+        r.add("pool memos", hashTableBytes(maxMemo) + hashTableBytes(minMemo) + hashTableBytes(turnMemo) + hashTableBytes(mergeMemo)
+                            + hashTableBytes(onlyLeftMemo) + hashTableBytes(onlyRightMemo));
+    }
+    
+    // Quiebres promedio por linea internada (decodifica todas)
+    double averageLineLength() const
+    {
+        ThermoLine l;
+        size_t breakpoints = 0;
+        for (LineId id = 0; id < lines.size(); id++)
+        {
+            line(id, l);
+            breakpoints += l.v.size();
+        }
+        return lines.empty() ? 0 : double(breakpoints) / double(lines.size());
+    }
+    
+    void clear() { *this = ThermoPool(); }
+};
 
 struct GameTree
 {
@@ -522,14 +1006,17 @@ struct GameTree
     bool operator ==(const GameTree &o) const { return left == o.left && right == o.right;}
 };
 
-void thermograph(ThermoGraph &ret, const GameTree &game)
+// Termografo de game a partir de los de sus opciones: evaluate(lado, i, termografo) da el de la i-esima opcion de ese
+// lado (0 izquierda, 1 derecha). Las opciones se combinan siempre en orden.
+template <typename Evaluate>
+void thermographOfOptions(ThermoGraph &ret, const GameTree &game, Evaluate evaluate)
 {
     bool pri = true;
     ThermoLine bestLeft;
-    for (const auto &option : game.left)
+    for (size_t i = 0; i < game.left.size(); i++)
     {
         ThermoGraph otg;
-        thermograph(otg, option);
+        evaluate(0, i, otg);
         otg.right.startsUp ^= 1;
         if (pri)
         {
@@ -545,10 +1032,10 @@ void thermograph(ThermoGraph &ret, const GameTree &game)
     }
     pri = true;
     ThermoLine bestRight;
-    for (const auto &option : game.right)
+    for (size_t i = 0; i < game.right.size(); i++)
     {
         ThermoGraph otg;
-        thermograph(otg, option);
+        evaluate(1, i, otg);
         otg.left.startsUp ^= 1;
         if (pri)
         {
@@ -571,3 +1058,466 @@ void thermograph(ThermoGraph &ret, const GameTree &game)
     else
         merge(ret, bestLeft, bestRight);
 }
+
+inline void thermograph(ThermoGraph &ret, const GameTree &game)
+{
+    thermographOfOptions(ret, game, [&](int side, size_t i, ThermoGraph &otg) { thermograph(otg, side == 0 ? game.left[i] : game.right[i]); });
+}
+
+// Cantidad de nodos del arbol, contando a lo sumo hasta limit
+inline size_t gameSize(const GameTree &game, size_t limit)
+{
+    size_t size = 1;
+    for (const vector<GameTree> *side : {&game.left, &game.right})
+        for (const GameTree &option : *side)
+        {
+            if (size >= limit) return limit;
+            size += gameSize(option, limit - size);
+        }
+    return min(size, limit);
+}
+
+// Evaluacion fork-join de arboles grandes: las opciones con al menos threshold nodos se resuelven en otro hilo (mientras
+// haya hilos libres) y las demas en el hilo actual; despues se combinan en el mismo orden que en thermograph(), asi que el
+// resultado es identico. takeMax / takeMin / merge solo usan memoria local al hilo.
+const size_t PARALLEL_GAME_THRESHOLD = 1 << 12;
+
+struct ParallelGameEvaluator
+{
+    size_t threshold;
+    atomic<int> spareThreads;
+    
+    ParallelGameEvaluator(size_t threshold_, int threads) : threshold(threshold_), spareThreads(threads - 1) {}
+    
+    bool takeThread()
+    {
+        int spare = spareThreads.load();
+        while (spare > 0)
+            if (spareThreads.compare_exchange_weak(spare, spare - 1))
+                return true;
+        return false;
+    }
+    
+    void evaluate(ThermoGraph &ret, const GameTree &game)
+    {
+        const vector<GameTree> *sides[2] = {&game.left, &game.right};
+        vector<future<ThermoGraph> > forks[2];
+        vector<bool> big[2];
+        for (int side = 0; side < 2; side++)
+        {
+            forks[side].resize(sides[side]->size());
+            big[side].resize(sides[side]->size());
+            for (size_t i = 0; i < sides[side]->size(); i++)
+            {
+                const GameTree &option = (*sides[side])[i];
+                big[side][i] = gameSize(option, threshold) >= threshold;
+                if (big[side][i] && takeThread())
+                    forks[side][i] = async(launch::async, [this, &option]
+                    {
+                        ThermoGraph t;
+                        evaluate(t, option);
+                        spareThreads++;
+                        return t;
+                    });
+            }
+        }
+        thermographOfOptions(ret, game, [&](int side, size_t i, ThermoGraph &otg)
+        {
+            if (forks[side][i].valid())
+                otg = forks[side][i].get();
+            else if (big[side][i])
+                evaluate(otg, (*sides[side])[i]);
+            else
+                thermograph(otg, (*sides[side])[i]);
+        });
+    }
+};
+
+inline void parallelThermograph(ThermoGraph &ret, const GameTree &game, size_t threshold = PARALLEL_GAME_THRESHOLD,
+                         int threads = max(1, int(thread::hardware_concurrency())))
+{
+    ParallelGameEvaluator(threshold, threads).evaluate(ret, game);
+}
+
+
+// Representacion plana de juegos: un DAG con los nodos guardados en un arreglo contiguo y las opciones como rangos de indices.
+// Los nodos se construyen de abajo hacia arriba (toda opcion tiene un id menor que el nodo que la usa), y los nodos
+// identicos se comparten, asi que un arbol grande con subarboles repetidos ocupa solo lo que ocupan sus nodos distintos.
+
+typedef unsigned int GameId;
+
+const GameId NO_GAME = GameId(-1);
+
+struct GameNode
+{
+    // Opciones izquierdas en options[leftBegin, rightBegin), derechas en options[rightBegin, rightEnd)
+    unsigned int leftBegin, rightBegin, rightEnd;
+};
+
+struct GameArena
+{
+    vector<GameNode> nodes;
+    vector<GameId> options;
+    unordered_multimap<size_t, GameId> index; // hash de las opciones -> nodos con ese hash
+    vector<GameId> canonicalOf;                   // Memo de canonical(), NO_GAME si todavia no se calculo
+    unordered_map<unsigned long long, bool> leMemo; // Memo de le(), clave (g << 32) | h
+    unordered_map<unsigned long long, GameId> shiftMemo; // Memo de shift(), clave (g << 32) | n
+    
+    size_t size() const { return nodes.size(); }
+    const GameId *leftBegin (GameId g) const { return options.data() + nodes[g].leftBegin; }
+    const GameId *leftEnd   (GameId g) const { return options.data() + nodes[g].rightBegin; }
+    const GameId *rightBegin(GameId g) const { return options.data() + nodes[g].rightBegin; }
+    const GameId *rightEnd  (GameId g) const { return options.data() + nodes[g].rightEnd; }
+    bool noLeft (GameId g) const { return nodes[g].leftBegin == nodes[g].rightBegin; }
+    bool noRight(GameId g) const { return nodes[g].rightBegin == nodes[g].rightEnd; }
+    
+    // Builder: las opciones repetidas se descartan y el orden no importa. Si el nodo ya existia, devuelve el mismo id.
+    GameId add(vector<GameId> left, vector<GameId> right)
+    {
+        sort(left.begin(), left.end());
+        left.erase(unique(left.begin(), left.end()), left.end());
+        sort(right.begin(), right.end());
+        right.erase(unique(right.begin(), right.end()), right.end());
+        size_t h = left.size();
+        for (GameId x : left)  h = h * 1000003 + x;
+        h = h * 1000003 + right.size();
+        for (GameId x : right) h = h * 1000003 + x;
+        auto range = index.equal_range(h);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            GameId g = it->second;
+            if (equal(leftBegin(g), leftEnd(g), left.begin(), left.end()) && equal(rightBegin(g), rightEnd(g), right.begin(), right.end()))
+                return g;
+        }
+        for (GameId x : left)  assert(x < nodes.size());
+        for (GameId x : right) assert(x < nodes.size());
+        GameNode node;
+        node.leftBegin = (unsigned int)options.size();
+        options.insert(options.end(), left.begin(), left.end());
+        node.rightBegin = (unsigned int)options.size();
+        options.insert(options.end(), right.begin(), right.end());
+        node.rightEnd = (unsigned int)options.size();
+        GameId g = GameId(nodes.size());
+        nodes.push_back(node);
+        index.emplace(h, g);
+        return g;
+    }
+    
+    GameId add(const GameTree &game)
+    {
+        vector<GameId> left, right;
+        for (const auto &option : game.left)  left .push_back(add(option));
+        for (const auto &option : game.right) right.push_back(add(option));
+        return add(left, right);
+    }
+    
+    // G + n para un entero n: si n > 0, {G^L + n, G + (n-1) | G^R + n} (n = {n-1 | }), y simetrico si n < 0.
+    GameId shift(GameId g, int n)
+    {
+        if (n == 0) return g;
+        unsigned long long key = ((unsigned long long)g << 32) | (unsigned int)n;
+        auto it = shiftMemo.find(key);
+        if (it != shiftMemo.end()) return it->second;
+        // Copiamos las opciones antes de recursionar: add() puede realocar options.
+        vector<GameId> left(leftBegin(g), leftEnd(g)), right(rightBegin(g), rightEnd(g));
+        for (GameId &x : left)  x = shift(x, n);
+        for (GameId &x : right) x = shift(x, n);
+        if (n > 0)
+            left.push_back(shift(g, n - 1));
+        else
+            right.push_back(shift(g, n + 1));
+        GameId ret = add(left, right);
+        shiftMemo[key] = ret;
+        return ret;
+    }
+    
+    // G <= H sii no existe G^L >= H ni H^R <= G (es decir, H - G >= 0).
+    bool le(GameId g, GameId h)
+    {
+        if (g == h) return true;
+        unsigned long long key = ((unsigned long long)g << 32) | h;
+        auto it = leMemo.find(key);
+        if (it != leMemo.end()) return it->second;
+        bool ret = true;
+        for (const GameId *x = leftBegin(g); ret && x != leftEnd(g); x++)
+            if (le(h, *x)) ret = false;
+        for (const GameId *x = rightBegin(h); ret && x != rightEnd(h); x++)
+            if (le(*x, g)) ret = false;
+        leMemo[key] = ret;
+        return ret;
+    }
+    bool ge(GameId g, GameId h) { return le(h, g); }
+    bool equalValue(GameId g, GameId h) { return le(g, h) && le(h, g); }
+    
+    // Forma canonica: se eliminan opciones dominadas y se puentean las reversibles, hasta que no quede ninguna.
+    // Como los nodos identicos se comparten, dos juegos son iguales sii tienen el mismo id canonico.
+    GameId canonical(GameId g)
+    {
+        if (canonicalOf.size() < nodes.size()) canonicalOf.resize(nodes.size(), NO_GAME);
+        if (canonicalOf[g] != NO_GAME) return canonicalOf[g];
+        // Copiamos las opciones antes de recursionar: add() puede realocar options.
+        vector<GameId> left(leftBegin(g), leftEnd(g)), right(rightBegin(g), rightEnd(g));
+        for (GameId &x : left)  x = canonical(x);
+        for (GameId &x : right) x = canonical(x);
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            // Reversibles: G^L se revierte por G^{LR} <= G, y se reemplaza por las opciones izquierdas de G^{LR}.
+            // Las comparaciones se hacen contra g, que tiene el mismo valor que el juego que vamos armando.
+            for (int i = 0; i < (int)left.size(); i++)
+            {
+                GameId option = left[i];
+                for (const GameId *x = rightBegin(option); x != rightEnd(option); x++)
+                if (le(*x, g))
+                {
+                    GameId reverse = *x;
+                    left.erase(left.begin() + i);
+                    left.insert(left.end(), leftBegin(reverse), leftEnd(reverse));
+                    i--;
+                    changed = true;
+                    break;
+                }
+            }
+            for (int i = 0; i < (int)right.size(); i++)
+            {
+                GameId option = right[i];
+                for (const GameId *x = leftBegin(option); x != leftEnd(option); x++)
+                if (le(g, *x))
+                {
+                    GameId reverse = *x;
+                    right.erase(right.begin() + i);
+                    right.insert(right.end(), rightBegin(reverse), rightEnd(reverse));
+                    i--;
+                    changed = true;
+                    break;
+                }
+            }
+            // Dominadas: para Left sobra toda opcion <= otra, para Right toda opcion >= otra.
+            // Las opciones ya son canonicas, asi que dos opciones iguales tienen el mismo id y se descartan en add().
+            sort(left.begin(), left.end());
+            left.erase(unique(left.begin(), left.end()), left.end());
+            sort(right.begin(), right.end());
+            right.erase(unique(right.begin(), right.end()), right.end());
+            vector<GameId> kept;
+            for (GameId a : left)
+            {
+                bool dominated = false;
+                for (GameId b : left) if (a != b && le(a, b)) { dominated = true; break; }
+                if (dominated) changed = true;
+                else kept.push_back(a);
+            }
+            swap(left, kept);
+            kept.clear();
+            for (GameId a : right)
+            {
+                bool dominated = false;
+                for (GameId b : right) if (a != b && le(b, a)) { dominated = true; break; }
+                if (dominated) changed = true;
+                else kept.push_back(a);
+            }
+            swap(right, kept);
+        }
+        GameId ret = add(left, right);
+        if (canonicalOf.size() < nodes.size()) canonicalOf.resize(nodes.size(), NO_GAME);
+        canonicalOf[g] = canonicalOf[ret] = ret;
+        return ret;
+    }
+    
+    // Formato de texto: cantidad de nodos, y luego por cada nodo "nL l_1 ... l_nL nR r_1 ... r_nR", donde las opciones
+    // son indices (desde 0) de nodos anteriores del archivo. Devuelve el id del ultimo nodo leido.
+    GameId read(istream &is)
+    {
+        int n;
+        is >> n;
+        assert(n > 0);
+        vector<GameId> fileIds(n), left, right;
+        for (int i = 0; i < n; i++)
+        {
+            int nL, nR, x;
+            left.clear(); right.clear();
+            is >> nL;
+            for (int k = 0; k < nL; k++) { is >> x; assert(0 <= x && x < i); left.push_back(fileIds[x]); }
+            is >> nR;
+            for (int k = 0; k < nR; k++) { is >> x; assert(0 <= x && x < i); right.push_back(fileIds[x]); }
+            assert(is);
+            fileIds[i] = add(left, right);
+        }
+        return fileIds.back();
+    }
+};
+
+inline void thermograph(ThermoGraph &ret, const GameArena &arena, GameId game)
+{
+    // Como toda opcion tiene id menor, alcanza con marcar los nodos alcanzables bajando por ids y evaluarlos subiendo.
+    // Cada nodo del DAG se evalua una sola vez y sin recursion.
+    assert(game < arena.size());
+    vector<bool> reachable(game + 1, false);
+    reachable[game] = true;
+    for (GameId g = game + 1; g-- > 0;)
+    if (reachable[g])
+    {
+        for (const GameId *x = arena.leftBegin(g); x != arena.rightEnd(g); x++)
+            reachable[*x] = true;
+    }
+    vector<ThermoGraph> results(game + 1);
+    ThermoLine bestLeft, bestRight, aux;
+    for (GameId g = 0; g <= game; g++)
+    if (reachable[g])
+    {
+        bool pri = true;
+        for (const GameId *x = arena.leftBegin(g); x != arena.leftEnd(g); x++)
+        {
+            ThermoLine line = results[*x].right;
+            line.startsUp ^= 1;
+            if (pri)
+            {
+                bestLeft = line;
+                pri = false;
+            }
+            else
+            {
+                takeMax(aux, bestLeft, line);
+                swap(bestLeft, aux);
+            }
+        }
+        pri = true;
+        for (const GameId *x = arena.rightBegin(g); x != arena.rightEnd(g); x++)
+        {
+            ThermoLine line = results[*x].left;
+            line.startsUp ^= 1;
+            if (pri)
+            {
+                bestRight = line;
+                pri = false;
+            }
+            else
+            {
+                takeMin(aux, bestRight, line);
+                swap(bestRight, aux);
+            }
+        }
+        if (arena.noLeft(g) && arena.noRight(g))
+            results[g] = ZERO_THERMOGRAPH;
+        else if (arena.noLeft(g))
+            mergeOnlyRight(results[g], bestRight);
+        else if (arena.noRight(g))
+            mergeOnlyLeft(results[g], bestLeft);
+        else
+            merge(results[g], bestLeft, bestRight);
+    }
+    ret = results[game];
+}
+
+// Igual que thermograph, pero sobre la forma canonica: el costo sigue al tamanio del juego simplificado.
+inline void canonicalThermograph(ThermoGraph &ret, GameArena &arena, GameId game)
+{
+    thermograph(ret, arena, arena.canonical(game));
+}
+
+inline void canonicalThermograph(ThermoGraph &ret, const GameTree &game)
+{
+    GameArena arena;
+    canonicalThermograph(ret, arena, arena.add(game));
+}
+
+// Suma disyuntiva de juegos del arena, sin construirla: el estado es el multiconjunto de componentes (ordenado, sin ceros)
+// y sus opciones se generan al evaluarlo, moviendo en un solo componente (G^L + H, G + H^L, ...). Los termografos se
+// memorizan por estado, asi que el costo sigue a la cantidad de combinaciones de subjuegos alcanzables y no al tamanio
+// del arbol de la suma.
+struct GameSum
+{
+    struct Hash
+    {
+        size_t operator()(const vector<GameId> &v) const
+        {
+            size_t h = v.size();
+            for (GameId x : v) h = h * 1000003 + x;
+            return h;
+        }
+    };
+    
+    const GameArena &arena;
+    unordered_map<vector<GameId>, ThermoGraph, Hash> memo;
+    
+    explicit GameSum(const GameArena &arena_) : arena(arena_) {}
+    
+    // Los componentes sin opciones (el cero) no cambian la suma
+    vector<GameId> normalize(vector<GameId> components) const
+    {
+        components.erase(remove_if(components.begin(), components.end(), [&](GameId g) { return arena.noLeft(g) && arena.noRight(g); }),
+                         components.end());
+        sort(components.begin(), components.end());
+        return components;
+    }
+    
+    vector<GameId> move(const vector<GameId> &components, size_t i, GameId option) const
+    {
+        vector<GameId> ret = components;
+        ret[i] = option;
+        return normalize(ret);
+    }
+    
+    // components tiene que estar normalizado
+    const ThermoGraph &evaluate(const vector<GameId> &components)
+    {
+        auto it = memo.find(components);
+        if (it != memo.end()) return it->second;
+        // Inicializadas: el primer swap lee los campos de bestLeft / bestRight
+        ThermoLine bestLeft = ThermoLine(), bestRight = ThermoLine(), line, aux;
+        bool anyLeft = false, anyRight = false;
+        for (size_t i = 0; i < components.size(); i++)
+        {
+            // Mover en cualquiera de dos componentes iguales lleva a la misma suma
+            if (i > 0 && components[i] == components[i-1]) continue;
+            GameId g = components[i];
+            for (const GameId *x = arena.leftBegin(g); x != arena.leftEnd(g); x++)
+            {
+                line = evaluate(move(components, i, *x)).right;
+                line.startsUp ^= 1;
+                if (!anyLeft)
+                    swap(bestLeft, line);
+                else
+                {
+                    takeMax(aux, bestLeft, line);
+                    swap(bestLeft, aux);
+                }
+                anyLeft = true;
+            }
+            for (const GameId *x = arena.rightBegin(g); x != arena.rightEnd(g); x++)
+            {
+                line = evaluate(move(components, i, *x)).left;
+                line.startsUp ^= 1;
+                if (!anyRight)
+                    swap(bestRight, line);
+                else
+                {
+                    takeMin(aux, bestRight, line);
+                    swap(bestRight, aux);
+                }
+                anyRight = true;
+            }
+        }
+        ThermoGraph ret;
+        if (!anyLeft && !anyRight)
+            ret = ZERO_THERMOGRAPH;
+        else if (!anyLeft)
+            mergeOnlyRight(ret, bestRight);
+        else if (!anyRight)
+            mergeOnlyLeft(ret, bestLeft);
+        else
+            merge(ret, bestLeft, bestRight);
+        return memo.emplace(components, ret).first->second;
+    }
+    
+    void thermograph(ThermoGraph &ret, const vector<GameId> &components) { ret = evaluate(normalize(components)); }
+};
+
+// Termografo de la suma de los componentes. Se pasan a forma canonica antes de sumar, lo que achica los estados.
+inline void sumThermograph(ThermoGraph &ret, const vector<GameTree> &components)
+{
+    GameArena arena;
+    vector<GameId> ids;
+    for (const GameTree &g : components) ids.push_back(arena.canonical(arena.add(g)));
+    GameSum(arena).thermograph(ret, ids);
+}
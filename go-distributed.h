@@ -0,0 +1,274 @@
+#pragma once
+#include "go.h"
+#include <cerrno>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+// Busqueda repartida entre varios procesos de la misma maquina. El coordinador expande los primeros niveles del arbol
+// (splitDepth jugadas desde la raiz), y cada posicion de ese nivel es una tarea. Los workers son fork() del coordinador:
+// toman tareas de un contador compartido, las resuelven con su copia del Solver (con el camino desde la raiz marcado como
+// pendiente, igual que en la busqueda recursiva) y publican lo que terminan sin depender de un ciclo en una SharedTable en
+// memoria compartida POSIX, que consultan los demas. Cada resultado sin ciclo vuelve tambien al coordinador por un pipe.
+//
+// Lo que depende de un ciclo depende del orden de exploracion (ver CYCLIC_ENTRY), y los workers exploran en otro orden que
+// la busqueda en un solo proceso: eso no se usa. Al final el coordinador resuelve start con la busqueda recursiva, con los
+// resultados sin ciclo en su tabla y la SharedTable como nivel de consulta, asi que el resultado es el mismo que sin
+// workers; los workers solo le ahorran las partes sin ciclos. Si un worker se cae, o no se puede armar la memoria
+// compartida, los pipes o los procesos, lo que falte lo resuelve el coordinador.
+//
+// El limite de nodos del Budget es para toda la busqueda, no por tarea: los workers lo descuentan de un contador compartido
+// (ver Solver::sharedNodes) y el coordinador termina con lo que sobre. El plazo es el mismo para todos.
+
+const size_t SHARED_SLOTS = 1 << 20;
+const size_t SHARED_ARENA_BYTES = 64 << 20;
+
+struct DistributedSearch
+{
+    struct Task
+    {
+        vector<Solver::PathStep> path;
+        Board target;
+        int captureCount;
+    };
+    // La SharedTable va inmediatamente despues: con alignas queda alineada (y fuera de la linea de cache del contador)
+    struct alignas(64) Control
+    {
+        atomic<unsigned int> nextTask;
+        atomic<long long> nodesLeft;
+    };
+
+    Solver &solver;
+    int splitDepth;
+    vector<Task> tasks;
+
+    DistributedSearch(Solver &solver_, int splitDepth_) : solver(solver_), splitDepth(splitDepth_) {}
+
+    template <typename Visit> void forEachMove(const Board &board, Visit visit)
+    {
+        Board retaken;
+        if (solver.koMonster == 0)
+            ::forEachMove<0>(solver.geometry, board, visit, retaken);
+        else
+            ::forEachMove<1>(solver.geometry, board, visit, retaken);
+    }
+
+    bool onPath(const vector<Solver::PathStep> &path, const Board &b)
+    {
+        for (const Solver::PathStep &step : path)
+            if (step.board == b) return true;
+        return false;
+    }
+
+    void expand(vector<Solver::PathStep> &path, const Board &board, int captureCount)
+    {
+        path.push_back(Solver::PathStep{board, captureCount});
+        forEachMove(board, [&](int, const Board &option, int capturedDiff)
+        {
+            int optionCaptures = captureCount + capturedDiff;
+            if (int(path.size()) < splitDepth && !onPath(path, option) && solver.transpositionTable.find(option) == nullptr)
+                expand(path, option, optionCaptures);
+            else if (!onPath(path, option) && solver.transpositionTable.find(option) == nullptr)
+                tasks.push_back(Task{path, option, optionCaptures});
+        });
+        path.pop_back();
+    }
+
+    static void writeAll(int fd, const vector<unsigned char> &bytes)
+    {
+        for (size_t done = 0; done < bytes.size();)
+        {
+            ssize_t n = write(fd, bytes.data() + done, bytes.size() - done);
+            if (n <= 0) _exit(1);
+            done += n;
+        }
+    }
+
+    static void putWord(vector<unsigned char> &out, unsigned int x)
+    {
+        for (int i = 0; i < 4; i++) out.push_back((unsigned char)(x >> (8*i)));
+    }
+
+    static unsigned int getWord(const unsigned char *in)
+    {
+        unsigned int x = 0;
+        for (int i = 0; i < 4; i++) x |= (unsigned int)in[i] << (8*i);
+        return x;
+    }
+
+    // Registro de un resultado exacto y sin ciclo: tarea, largo, y las dos lineas con encodeLine.
+    void work(int fd, Control *control, const Budget &budget)
+    {
+        vector<unsigned char> record, lines;
+        if (budget.maxNodes != LLONG_MAX) solver.sharedNodes = &control->nodesLeft;
+        for (unsigned int t = control->nextTask++; t < tasks.size(); t = control->nextTask++)
+        {
+            if (solver.sharedNodes != nullptr && control->nodesLeft <= 0) break;
+            GraphId lower, upper;
+            int lowestUsed = solver.solveBelow(lower, upper, tasks[t].path, tasks[t].target, tasks[t].captureCount, budget);
+            // outOfBudget() descuenta de a 1024: falta lo que quedo de la ultima tanda
+            if (solver.sharedNodes != nullptr) control->nodesLeft -= solver.nodes & 1023;
+            if (lowestUsed != CYCLE_FREE || upper != lower) continue;
+            lines.clear();
+            encodeLine(solver.pool.line(solver.pool.left(lower)), lines);
+            encodeLine(solver.pool.line(solver.pool.right(lower)), lines);
+            record.clear();
+            putWord(record, t);
+            putWord(record, (unsigned int)lines.size());
+            record.insert(record.end(), lines.begin(), lines.end());
+            writeAll(fd, record);
+        }
+    }
+
+    // Consume los registros completos de buffer
+    void receive(vector<unsigned char> &buffer)
+    {
+        size_t used = 0;
+        while (buffer.size() - used >= 8)
+        {
+            unsigned int t = getWord(&buffer[used]);
+            unsigned int size = getWord(&buffer[used + 4]);
+            if (buffer.size() - used - 8 < size) break;
+            assert(t < tasks.size());
+            ThermoGraph result;
+            const unsigned char *in = &buffer[used + 8];
+            in = decodeLine(in, result.left);
+            decodeLine(in, result.right);
+            solver.store(tasks[t].target, solver.pool.intern(result), CYCLE_FREE);
+            used += 8 + size;
+        }
+        buffer.erase(buffer.begin(), buffer.begin() + used);
+    }
+
+    // Reserva la memoria compartida; nullptr (con el motivo en cerr) si no se puede.
+    void *mapShared(size_t bytes)
+    {
+        string name = "/miai-" + to_string(getpid());
+        int shm = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (shm < 0)
+        {
+            perror("shm_open");
+            return nullptr;
+        }
+        shm_unlink(name.c_str()); // El mapeo sigue vivo en el coordinador y en los hijos
+        void *memory = nullptr;
+        if (ftruncate(shm, off_t(bytes)) != 0)
+            perror("ftruncate");
+        else if ((memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0)) == MAP_FAILED)
+        {
+            perror("mmap");
+            memory = nullptr;
+        }
+        close(shm);
+        return memory;
+    }
+
+    BoundedThermoGraph solve(const Board &start, const Budget &budget, int workers)
+    {
+        const GraphId *known = solver.transpositionTable.find(start);
+        if (workers <= 1 || known != nullptr)
+            return solver.solve(start, budget);
+        vector<Solver::PathStep> path;
+        expand(path, start, 0);
+
+        size_t bytes = sizeof(Control) + SharedTable::bytesFor(SHARED_SLOTS, SHARED_ARENA_BYTES);
+        void *memory = mapShared(bytes);
+        if (memory == nullptr)
+        {
+            cerr << "cannot set up shared memory, solving in a single process" << endl;
+            return solver.solve(start, budget);
+        }
+        Control *control = new (memory) Control;
+        control->nextTask = 0;
+        control->nodesLeft = budget.maxNodes;
+        SharedTable table;
+        table.create((char *)memory + sizeof(Control), SHARED_SLOTS, SHARED_ARENA_BYTES);
+
+        vector<pid_t> pids;
+        vector<int> fds;
+        for (int w = 0; w < workers; w++)
+        {
+            int p[2];
+            if (pipe(p) != 0)
+            {
+                perror("pipe");
+                break;
+            }
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                perror("fork");
+                close(p[0]);
+                close(p[1]);
+                break;
+            }
+            if (pid == 0)
+            {
+                close(p[0]);
+                for (int fd : fds) close(fd);
+                solver.shared = &table;
+                work(p[1], control, budget);
+                _exit(0);
+            }
+            close(p[1]);
+            pids.push_back(pid);
+            fds.push_back(p[0]);
+        }
+        if (int(pids.size()) < workers)
+            cerr << "started " << pids.size() << " of " << workers << " workers" << endl;
+
+        vector<vector<unsigned char> > buffers(pids.size());
+        vector<pollfd> polls;
+        for (int fd : fds) polls.push_back(pollfd{fd, POLLIN, 0});
+        for (size_t open = pids.size(); open > 0;)
+        {
+            int ready = poll(polls.data(), polls.size(), -1);
+            if (ready < 0)
+            {
+                if (errno == EINTR) continue;
+                perror("poll");
+                // Sin poder leer, los workers se cortan al escribir en el pipe cerrado
+                for (pollfd &p : polls)
+                    if (p.fd >= 0) close(p.fd);
+                break;
+            }
+            for (size_t w = 0; w < polls.size(); w++)
+            {
+                if (polls[w].fd < 0 || polls[w].revents == 0) continue;
+                unsigned char chunk[1 << 16];
+                ssize_t n = read(polls[w].fd, chunk, sizeof(chunk));
+                if (n > 0)
+                {
+                    buffers[w].insert(buffers[w].end(), chunk, chunk + n);
+                    receive(buffers[w]);
+                }
+                else if (n == 0 || errno != EINTR)
+                {
+                    close(polls[w].fd);
+                    polls[w].fd = -1;
+                    open--;
+                }
+            }
+        }
+        for (size_t w = 0; w < pids.size(); w++)
+        {
+            int status;
+            waitpid(pids[w], &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                cerr << "worker " << w << " failed, solving its tasks locally" << endl;
+        }
+
+        // La busqueda recursiva de siempre, que encuentra en la tabla (o en la SharedTable) todo lo que los workers
+        // resolvieron sin ciclos.
+        solver.shared = &table;
+        Budget rest = budget;
+        rest.maxNodes = min(budget.maxNodes, max(control->nodesLeft.load(), 0LL));
+        BoundedThermoGraph result = solver.solve(start, rest);
+        solver.shared = nullptr;
+        munmap(memory, bytes);
+        return result;
+    }
+};
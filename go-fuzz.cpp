@@ -0,0 +1,104 @@
+#include "go.h"
+#include <random>
+#include <sstream>
+
+// Validacion diferencial de la busqueda: genera posiciones chicas al azar, y en las que no tienen ciclos compara para
+// las cuatro configuraciones el termografo de Solver con el del juego exportado (ver crossCheck en go.h). Cada diferencia
+// se informa con la posicion en el formato de example.in, para poder reproducirla con go, y hace terminar con error.
+// Tambien se cuentan cuantas de ellas alcanzan una retoma del koban.
+//
+// Uso: go-fuzz [CASOS=1000] [SEMILLA=1] [MAX_POSICIONES=20000]
+
+// Tablero al azar de 2x2 a 3x4 intersecciones, con bordes X / B / W
+string randomPosition(mt19937_64 &rng)
+{
+    int n = 2 + int(rng() % 2), m = 2 + int(rng() % 3);
+    const char border[] = "XXBW";
+    const char cell[] = "..BW";
+    ostringstream os;
+    os << n + 2 << " " << m + 2 << endl;
+    for (int i = 0; i < n + 2; i++)
+    {
+        for (int j = 0; j < m + 2; j++)
+        {
+            bool edge = i == 0 || j == 0 || i == n + 1 || j == m + 1;
+            bool corner = (i == 0 || i == n + 1) && (j == 0 || j == m + 1);
+            os << (corner ? 'X' : edge ? border[rng() % 4] : cell[rng() % 4]);
+        }
+        os << endl;
+    }
+    return os.str();
+}
+
+// Todo grupo tiene alguna libertad (o toca un borde de su color)
+bool legal(const Geometry &geometry, const Board &board)
+{
+    vector<bool> seen(geometry.totalArea, false);
+    for (int start = 0; start < geometry.totalArea; start++)
+    {
+        BoardIntersection color = board.get(Index(start));
+        if (seen[start] || (color != BLACK && color != WHITE)) continue;
+        bool alive = false;
+        vector<int> stack{start};
+        seen[start] = true;
+        while (!stack.empty())
+        {
+            int x = stack.back();
+            stack.pop_back();
+            for (int dir = 0; dir < 4; dir++)
+            {
+                Index y = geometry.neighbors[x][dir];
+                if (y == OUTER_NULL) continue;
+                if (y == OUTER_BLACK || y == OUTER_WHITE)
+                {
+                    if ((y == OUTER_BLACK) == (color == BLACK)) alive = true;
+                }
+                else if (board.get(y) == color)
+                {
+                    if (!seen[y]) { seen[y] = true; stack.push_back(y); }
+                }
+                else if (board.emptyCell(y))
+                    alive = true;
+            }
+        }
+        if (!alive) return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int cases = argc >= 2 ? atoi(argv[1]) : 1000;
+    mt19937_64 rng(argc >= 3 ? atoll(argv[2]) : 1);
+    size_t maxPositions = argc >= 4 ? size_t(atoll(argv[3])) : 20000;
+    int acyclic = 0, mismatches = 0, retakeMismatches = 0;
+    for (int c = 0; c < cases; c++)
+    {
+        string text = randomPosition(rng);
+        istringstream is(text);
+        Geometry geometry;
+        Board board;
+        bool ok = tryReadBoard(is, geometry, board);
+        assert(ok);
+        if (!legal(geometry, board)) continue;
+        bool checked = false;
+        for (int koMonster = 0; koMonster < 2; koMonster++)
+        for (int messy = 0; messy < 2; messy++)
+        {
+            Solver solver(geometry, koMonster, messy);
+            ThermoGraph fromBoard, fromGame;
+            bool retake;
+            if (!crossCheck(solver, board, maxPositions, fromBoard, fromGame, retake)) continue;
+            checked = true;
+            if (!(fromBoard != fromGame)) continue;
+            mismatches++;
+            retakeMismatches += retake;
+            cout << "MISMATCH (KoMonster " << "BW"[koMonster] << ", Messy " << "BW"[messy] << "): board search " << fromBoard
+                 << ", game " << fromGame << (retake ? " (reaches a koban retake)" : "") << endl << text << endl;
+        }
+        acyclic += checked;
+    }
+    cout << "cases " << cases << ", acyclic " << acyclic << ", mismatches " << mismatches
+         << " (" << retakeMismatches << " reach a koban retake)" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+#include "go.h"
+#include <fstream>
+#include <sstream>
+
+// Genera la biblioteca de formas que usan go.cpp y go-server.cpp con --library. Para cada region de n x m (n, m >= 2,
+// area <= maxArea) y cada combinacion de bordes (cada lado 'X', 'B' o 'W'), resuelve el tablero vacio en las cuatro
+// configuraciones de reglas y guarda todas las posiciones que quedaron resueltas en la tabla. Algunas regiones (con ciclos
+// largos) no terminan en tiempo razonable: cada busqueda tiene un presupuesto de nodos, y de esas se guarda solo lo resuelto.
+// La biblioteca es un cache de tableros completos (ver ShapeLibrary): solo acierta en tableros de exactamente estas
+// dimensiones y bordes, no en una region igual dentro de un tablero mas grande.
+//
+// Uso: go-library ARCHIVO [maxArea] [maxNodes]     (por defecto maxArea 6 y maxNodes 200000)
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 4)
+    {
+        cerr << "Usage: " << argv[0] << " FILE [maxArea] [maxNodes]" << endl;
+        return 1;
+    }
+    int maxArea = argc >= 3 ? atoi(argv[2]) : 6;
+    assert(4 <= maxArea && maxArea <= MAX_AREA);
+    Budget budget;
+    budget.maxNodes = argc >= 4 ? atoll(argv[3]) : 200000;
+    
+    const char sideKinds[3] = {'X', 'B', 'W'};
+    ShapeLibrary library;
+    size_t entries = 0, incomplete = 0;
+    for (int n = 2; n * 2 <= maxArea; n++)
+    for (int m = 2; n * m <= maxArea; m++)
+    for (int sides = 0; sides < 81; sides++)
+    {
+        // Lados: arriba, abajo, izquierda, derecha. Las esquinas nunca son vecinas de nadie.
+        char top = sideKinds[sides % 3], bottom = sideKinds[sides / 3 % 3], left = sideKinds[sides / 9 % 3], right = sideKinds[sides / 27];
+        ostringstream text;
+        text << n+2 << " " << m+2 << endl;
+        text << 'X' << string(m, top) << 'X' << endl;
+        for (int i = 0; i < n; i++)
+            text << left << string(m, '.') << right << endl;
+        text << 'X' << string(m, bottom) << 'X' << endl;
+        istringstream is(text.str());
+        Geometry geometry;
+        Board empty = readBoard(is, geometry);
+        for (int koMonster = 0; koMonster < 2; koMonster++)
+        for (int messy = 0; messy < 2; messy++)
+        {
+            Solver solver(geometry, koMonster, messy);
+            if (!solver.solve(empty, budget).exact()) incomplete++;
+            solver.exportTo(library);
+            entries += solver.transpositionTable.size();
+        }
+    }
+    
+    ofstream out(argv[1], ios::binary);
+    library.save(out);
+    cerr << library.geometries.size() << " geometrias, " << entries << " posiciones, " << incomplete << " busquedas sin terminar" << endl;
+    return out ? 0 : 1;
+}
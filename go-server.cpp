@@ -0,0 +1,353 @@
+#include "go.h"
+#include <mutex>
+#include <thread>
+#include <future>
+#include <condition_variable>
+#include <memory>
+#include <list>
+#include <map>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fstream>
+#include <csignal>
+#include <cerrno>
+
+// Servidor de larga duracion: recibe posiciones en el formato de example.in y responde sus termografos (en el mismo formato
+// de salida que go.cpp, seguido de una linea vacia). Los Solvers de cada geometria se conservan entre pedidos, asi que las
+// posiciones repetidas o cercanas se resuelven contra una tabla ya caliente.
+//
+// Uso:
+//     go-server                  Lee pedidos de stdin y responde por stdout.
+//     go-server --socket PATH    Escucha en un Unix domain socket; cada conexion es un hilo y puede mandar varios pedidos.
+//     --library ARCHIVO          (en cualquiera de los dos modos) Biblioteca de formas que consultan todos los Solvers.
+//     --nodes N, --seconds S     Limite por pedido (por defecto, ninguno). Un pedido que no termina se responde con cotas,
+//                                como go con presupuesto, y lo ya resuelto queda en la tabla para el proximo.
+//
+// Ademas de tableros completos, se pueden mandar ediciones de la ultima posicion (ver readEdits), que se resuelven
+// reusando la tabla, y "LIMIT N S", que cambia el limite de los pedidos siguientes de la conexion (0 es sin limite).
+// Si un pedido no se puede leer, se responde "ERROR" y se cierra la conexion (en modo stdin, se termina).
+
+const size_t MAX_GEOMETRIES = 64;          // Geometrias con Solvers calientes (se descarta la usada hace mas tiempo)
+// Memoria de todos los Solvers calientes juntos, segun la estimacion de Solver::memory(). Despues de cada pedido se
+// descartan geometrias enteras, la usada hace mas tiempo primero, hasta quedar por debajo; un Solver que solo ya se pasa
+// de la cuarta parte vacia su tabla antes del pedido siguiente.
+const size_t MAX_CACHE_BYTES = size_t(2) << 30;
+const int MAX_CONNECTIONS = 16;
+
+ShapeLibrary library; // Se carga al arrancar y despues es de solo lectura
+
+// Limite de cada pedido, 0 si no hay. Como el Solver de una geometria se usa de a un pedido por vez, sin limite una
+// posicion que no termina bloquea a todos los pedidos siguientes de esa geometria.
+struct RequestLimit
+{
+    long long nodes = 0;
+    double seconds = 0;
+    
+    // El plazo corre desde que llega el pedido, incluyendo la espera por el Solver
+    Budget budget() const
+    {
+        Budget b;
+        if (nodes > 0) b.maxNodes = nodes;
+        if (seconds > 0)
+            b.deadline = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(seconds));
+        return b;
+    }
+};
+
+RequestLimit defaultLimit;
+
+struct WarmSolver
+{
+    mutex m;
+    Solver solver;
+    atomic<size_t> bytes; // Solver::memory() al terminar el ultimo pedido, para medir sin esperar al que esta en curso
+    WarmSolver(const Geometry &geometry, int koMonster, int messy) : solver(geometry, koMonster, messy), bytes(0) { solver.useLibrary(library); }
+
+    bool resolve(BoundedThermoGraph &ret, Board &board, const vector<CellEdit> &edits, const Budget &budget)
+    {
+        lock_guard<mutex> lock(m);
+        if (bytes > MAX_CACHE_BYTES / 4)
+            solver.clear();
+        bool ok = solver.resolve(ret, board, edits, budget);
+        MemoryReport report;
+        solver.memory(report);
+        bytes = report.total();
+        return ok;
+    }
+};
+
+struct GeometryEntry
+{
+    unique_ptr<WarmSolver> solvers[2][2];
+    list<string>::iterator lruPosition;
+
+    size_t bytes() const
+    {
+        size_t ret = 0;
+        for (int koMonster = 0; koMonster < 2; koMonster++)
+        for (int messy = 0; messy < 2; messy++)
+            ret += solvers[koMonster][messy]->bytes;
+        return ret;
+    }
+};
+
+struct SolverCache
+{
+    mutex m;
+    list<string> lru; // La mas reciente adelante
+    map<string, shared_ptr<GeometryEntry> > entries;
+
+    shared_ptr<GeometryEntry> get(const Geometry &geometry)
+    {
+        string key = geometryKey(geometry);
+        lock_guard<mutex> lock(m);
+        auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            lru.splice(lru.begin(), lru, it->second->lruPosition);
+            return it->second;
+        }
+        if (entries.size() >= MAX_GEOMETRIES)
+        {
+            // Los pedidos en curso conservan su shared_ptr, asi que descartar la entrada no los afecta.
+            entries.erase(lru.back());
+            lru.pop_back();
+        }
+        shared_ptr<GeometryEntry> entry = make_shared<GeometryEntry>();
+        for (int koMonster = 0; koMonster < 2; koMonster++)
+        for (int messy = 0; messy < 2; messy++)
+            entry->solvers[koMonster][messy].reset(new WarmSolver(geometry, koMonster, messy));
+        lru.push_front(key);
+        entry->lruPosition = lru.begin();
+        entries[key] = entry;
+        return entry;
+    }
+
+    // Descarta geometrias, la usada hace mas tiempo primero, hasta que todas juntas entren en MAX_CACHE_BYTES. La mas
+    // reciente queda siempre (su limite es el de cada Solver, ver WarmSolver::resolve). La memoria de una geometria
+    // descartada se libera cuando terminan los pedidos que la estan usando.
+    void trim()
+    {
+        lock_guard<mutex> lock(m);
+        while (entries.size() > 1)
+        {
+            // Los pedidos en curso cambian bytes en cualquier momento: se suma de nuevo en cada vuelta
+            size_t total = 0;
+            for (const auto &entry : entries) total += entry.second->bytes();
+            if (total <= MAX_CACHE_BYTES) break;
+            entries.erase(lru.back());
+            lru.pop_back();
+        }
+    }
+};
+
+SolverCache cache;
+
+// Responde board con edits aplicados (ver Solver::resolve), y deja el tablero editado en board. Devuelve false, sin
+// responder, si alguna edicion no es valida.
+bool answer(ostream &os, const Geometry &geometry, Board &board, const vector<CellEdit> &edits, const RequestLimit &limit)
+{
+    Budget budget = limit.budget();
+    shared_ptr<GeometryEntry> entry = cache.get(geometry);
+    // Las cuatro configuraciones son independientes: se resuelven en paralelo, cada una editando su copia del tablero.
+    future<bool> ok[2][2];
+    Board boards[2][2];
+    BoundedThermoGraph t[2][2];
+    for (int koMonster = 0; koMonster < 2; koMonster++)
+    for (int messy = 0; messy < 2; messy++)
+    {
+        WarmSolver *solver = entry->solvers[koMonster][messy].get();
+        BoundedThermoGraph *result = &t[koMonster][messy];
+        Board *edited = &boards[koMonster][messy];
+        *edited = board;
+        ok[koMonster][messy] = async(launch::async, [solver, result, edited, &edits, budget] { return solver->resolve(*result, *edited, edits, budget); });
+    }
+    bool valid = true;
+    for (int koMonster = 0; koMonster < 2; koMonster++)
+    for (int messy = 0; messy < 2; messy++)
+        valid = ok[koMonster][messy].get() && valid;
+    cache.trim();
+    if (!valid) return false;
+    board = boards[0][0];
+    printResults(os, t);
+    os << endl;
+    return true;
+}
+
+// LIMIT N S
+bool readLimit(istream &is, RequestLimit &limit)
+{
+    string command;
+    RequestLimit l;
+    if (!(is >> command >> l.nodes >> l.seconds) || command != "LIMIT" || l.nodes < 0 || l.seconds < 0) return false;
+    limit = l;
+    return true;
+}
+
+// EDIT k f_1 c_1 v_1 ... f_k c_k v_k: cambia k intersecciones de la ultima posicion de la conexion (fila y columna como en
+// el texto del tablero, contando el borde, y v uno de '.', 'B', 'W'). Que caigan dentro del tablero lo revisa resolve().
+bool readEdits(istream &is, vector<CellEdit> &edits)
+{
+    string command;
+    int k;
+    if (!(is >> command >> k) || command != "EDIT" || k < 0) return false;
+    edits.clear();
+    for (int i = 0; i < k; i++)
+    {
+        int row, col;
+        char value;
+        if (!(is >> row >> col >> value) || (value != '.' && value != 'B' && value != 'W')) return false;
+        edits.push_back(CellEdit{row - 1, col - 1, charToCell(value)});
+    }
+    return true;
+}
+
+void serve(istream &is, ostream &os)
+{
+    Geometry geometry;
+    Board board;
+    bool havePosition = false;
+    RequestLimit limit = defaultLimit;
+    while (os && is >> ws && is.peek() != EOF)
+    {
+        if (is.peek() == 'L')
+        {
+            if (readLimit(is, limit)) continue;
+            os << "ERROR" << endl;
+            return;
+        }
+        bool ok;
+        vector<CellEdit> edits;
+        if (is.peek() == 'E')
+            ok = havePosition && readEdits(is, edits);
+        else
+            ok = tryReadBoard(is, geometry, board);
+        // Los Solvers de la geometria conservan la tabla, asi que tras un EDIT solo se busca lo que cambio.
+        if (!ok || !answer(os, geometry, board, edits, limit))
+        {
+            os << "ERROR" << endl;
+            return;
+        }
+        havePosition = true;
+    }
+}
+
+// streambuf minimo sobre un file descriptor, para atender un socket con los mismos istream / ostream que stdin / stdout.
+struct FdStreamBuf : streambuf
+{
+    int fd;
+    char in[4096], out[4096];
+    explicit FdStreamBuf(int fd_) : fd(fd_) { setg(in, in, in); setp(out, out + sizeof(out)); }
+    ~FdStreamBuf() { sync(); }
+
+    int underflow() override
+    {
+        ssize_t n = read(fd, in, sizeof(in));
+        if (n <= 0) return traits_type::eof();
+        setg(in, in, in + n);
+        return traits_type::to_int_type(*gptr());
+    }
+    int overflow(int c) override
+    {
+        if (sync() != 0) return traits_type::eof();
+        if (c != traits_type::eof()) { *pptr() = char(c); pbump(1); }
+        return traits_type::not_eof(c);
+    }
+    // Si el cliente ya cerro (EPIPE / ECONNRESET, sin SIGPIPE: ver main) falla, y serve() termina esa conexion
+    int sync() override
+    {
+        for (char *p = pbase(); p < pptr();)
+        {
+            ssize_t n = write(fd, p, pptr() - p);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0)
+            {
+                setp(out, out + sizeof(out));
+                return -1;
+            }
+            p += n;
+        }
+        setp(out, out + sizeof(out));
+        return 0;
+    }
+};
+
+int serveSocket(const char *path)
+{
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) { perror("socket"); return 1; }
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) { cerr << "Socket path too long" << endl; return 1; }
+    strcpy(address.sun_path, path);
+    unlink(path);
+    if (bind(listener, (sockaddr *)&address, sizeof(address)) < 0) { perror("bind"); return 1; }
+    if (listen(listener, MAX_CONNECTIONS) < 0) { perror("listen"); return 1; }
+
+    mutex m;
+    condition_variable freed;
+    int connections = 0;
+    while (true)
+    {
+        {
+            unique_lock<mutex> lock(m);
+            freed.wait(lock, [&] { return connections < MAX_CONNECTIONS; });
+        }
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) { perror("accept"); continue; }
+        {
+            lock_guard<mutex> lock(m);
+            connections++;
+        }
+        thread([fd, &m, &freed, &connections]
+        {
+            {
+                FdStreamBuf buf(fd);
+                istream is(&buf);
+                ostream os(&buf);
+                serve(is, os);
+            }
+            close(fd);
+            lock_guard<mutex> lock(m);
+            connections--;
+            freed.notify_one();
+        }).detach();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *socketPath = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        string option = argv[i];
+        if (option == "--socket" && i + 1 < argc)
+            socketPath = argv[++i];
+        else if (option == "--nodes" && i + 1 < argc)
+            defaultLimit.nodes = atoll(argv[++i]);
+        else if (option == "--seconds" && i + 1 < argc)
+            defaultLimit.seconds = atof(argv[++i]);
+        else if (option == "--library" && i + 1 < argc)
+        {
+            ifstream is(argv[++i], ios::binary);
+            if (!library.load(is))
+            {
+                cerr << "Cannot load shape library " << argv[i] << endl;
+                return 1;
+            }
+        }
+        else
+        {
+            cerr << "Usage: " << argv[0] << " [--socket PATH] [--library FILE] [--nodes N] [--seconds S]" << endl;
+            return 1;
+        }
+    }
+    // Un cliente que se va sin leer la respuesta no puede tirar el servidor: el write falla con EPIPE y se cierra su conexion
+    signal(SIGPIPE, SIG_IGN);
+    if (socketPath != nullptr)
+        return serveSocket(socketPath);
+    serve(cin, cout);
+    return 0;
+}
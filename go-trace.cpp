@@ -0,0 +1,184 @@
+#include "go.h"
+#include <fstream>
+#include <queue>
+
+// Reporte de una traza grabada con go --trace (ver TraceRecorder). Por cada solve() de la traza muestra cuantas posiciones
+// termino de cada forma, cuantas se visitaron por profundidad, los subarboles que mas tiempo llevaron (con la jugada que
+// lleva a cada uno) y las posiciones que se buscaron mas de una vez (las que quedan sin guardar por depender de un ciclo se
+// re-exploran cada vez).
+//
+// Uso: go-trace ARCHIVO [N]     (N filas en cada ranking, 20 por defecto)
+
+const char *KIND_NAMES[] = {"solve", "summary", "hit", "pending", "library", "shared", "budget", "solved", "unstored"};
+
+struct Subtree
+{
+    TraceRecord record;
+    long long nodes; // Registros del subarbol, contando la raiz
+    unsigned long long exclusiveNs;
+    bool operator<(const Subtree &o) const { return record.durationNs > o.record.durationNs; } // Para un min-heap
+};
+
+struct Repeated
+{
+    long long searches = 0;
+    unsigned long long totalNs = 0;
+    short minDepth = SHRT_MAX;
+};
+
+struct SegmentReport
+{
+    size_t top;
+    TraceRecord solve;
+    long long kinds[9] = {};
+    vector<long long> depthNodes, depthSearched;
+    vector<long long> below;
+    vector<unsigned long long> childNs;
+    priority_queue<Subtree> slowest;
+    unordered_map<unsigned long long, Repeated> searched;
+    unordered_map<unsigned int, pair<Number, Number> > summaries;
+
+    SegmentReport(size_t top_, const TraceRecord &solve_) : top(top_), solve(solve_) {}
+
+    void add(const TraceRecord &r)
+    {
+        if (r.kind == TRACE_SUMMARY)
+        {
+            summaries[r.result] = make_pair(Number(r.mastNumerator, r.mastExp), Number(r.temperatureNumerator, r.temperatureExp));
+            return;
+        }
+        kinds[r.kind]++;
+        size_t d = size_t(r.depth);
+        if (depthNodes.size() < d + 2)
+        {
+            depthNodes.resize(d + 2);
+            depthSearched.resize(d + 2);
+            below.resize(d + 2);
+            childNs.resize(d + 2);
+        }
+        depthNodes[d]++;
+        // Los registros vienen en post-orden: los hijos de una posicion de profundidad d son los de profundidad d+1
+        // acumulados desde el registro anterior de profundidad <= d.
+        long long nodes = 1 + below[d+1];
+        unsigned long long exclusiveNs = r.durationNs - min(r.durationNs, childNs[d+1]);
+        below[d+1] = 0;
+        childNs[d+1] = 0;
+        below[d] += nodes;
+        childNs[d] += r.durationNs;
+        if (r.kind != TRACE_SOLVED && r.kind != TRACE_UNSTORED) return;
+        depthSearched[d]++;
+        Repeated &rep = searched[r.board];
+        rep.searches++;
+        rep.totalNs += r.durationNs;
+        rep.minDepth = min(rep.minDepth, r.depth);
+        slowest.push(Subtree{r, nodes, exclusiveNs});
+        if (slowest.size() > top) slowest.pop();
+    }
+
+    void printBoard(const string &prefix, unsigned long long key) const
+    {
+        Geometry geometry;
+        geometry.boardN = solve.depth;
+        geometry.boardM = solve.captureCount;
+        Board b;
+        b.bs = Bitset(key);
+        printPrefix(prefix, geometry, b);
+    }
+
+    // Fila y columna como en el texto del tablero, contando el borde (como las ediciones de go-server)
+    void printMove(const TraceRecord &r) const
+    {
+        int boardM = solve.captureCount;
+        if (r.move < 0) return;
+        cout << "BW"[r.player] << " ";
+        if (r.retake >= 0) cout << "retake " << r.retake / boardM + 1 << "," << r.retake % boardM + 1 << "  ";
+        if (r.move >= 0) cout << "move " << r.move / boardM + 1 << "," << r.move % boardM + 1 << "  ";
+    }
+
+    void printResult(unsigned int id) const
+    {
+        auto it = summaries.find(id);
+        if (it == summaries.end())
+            cout << "?";
+        else
+            cout << "mast " << it->second.first << " temp " << it->second.second;
+    }
+
+    void print() const
+    {
+        cout << "==== solve: KoMonster " << "BW"[solve.player >> 1] << ", Messy " << "BW"[solve.player & 1] << endl;
+        printBoard("    ", solve.board);
+        long long total = 0;
+        for (int k = TRACE_HIT; k <= TRACE_UNSTORED; k++) total += kinds[k];
+        cout << "records: " << total << endl;
+        for (int k = TRACE_HIT; k <= TRACE_UNSTORED; k++)
+            if (kinds[k] > 0)
+                cout << "    " << KIND_NAMES[k] << ": " << kinds[k] << endl;
+
+        cout << "depth  visited  searched" << endl;
+        for (size_t d = 1; d < depthNodes.size(); d++)
+            if (depthNodes[d] > 0)
+                cout << "    " << d << "  " << depthNodes[d] << "  " << depthSearched[d] << endl;
+
+        vector<Subtree> bySize;
+        for (priority_queue<Subtree> q = slowest; !q.empty(); q.pop()) bySize.push_back(q.top());
+        reverse(bySize.begin(), bySize.end());
+        cout << "slowest subtrees (inclusive ms, exclusive ms, nodes):" << endl;
+        for (const Subtree &s : bySize)
+        {
+            cout << "    " << s.record.durationNs / 1e6 << "  " << s.exclusiveNs / 1e6 << "  " << s.nodes
+                 << "  depth " << s.record.depth << "  " << KIND_NAMES[s.record.kind] << "  ";
+            printMove(s.record);
+            printResult(s.record.result);
+            cout << endl;
+            printBoard("        ", s.record.board);
+        }
+
+        vector<pair<unsigned long long, Repeated> > repeated;
+        for (const auto &entry : searched)
+            if (entry.second.searches > 1)
+                repeated.push_back(entry);
+        sort(repeated.begin(), repeated.end(), [](const pair<unsigned long long, Repeated> &a, const pair<unsigned long long, Repeated> &b)
+        {
+            return a.second.totalNs > b.second.totalNs;
+        });
+        if (repeated.size() > top) repeated.resize(top);
+        cout << "positions searched more than once (searches, total ms, min depth):" << endl;
+        for (const auto &entry : repeated)
+        {
+            cout << "    " << entry.second.searches << "  " << entry.second.totalNs / 1e6 << "  " << entry.second.minDepth << endl;
+            printBoard("        ", entry.first);
+        }
+        cout << endl;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        cerr << "Usage: " << argv[0] << " FILE [N]" << endl;
+        return 1;
+    }
+    ifstream is(argv[1], ios::binary);
+    if (!is)
+    {
+        cerr << "Cannot open " << argv[1] << endl;
+        return 1;
+    }
+    size_t top = argc == 3 ? size_t(atoi(argv[2])) : 20;
+    unique_ptr<SegmentReport> segment;
+    TraceRecord r;
+    while (is.read((char *)&r, sizeof(r)))
+    {
+        if (r.kind == TRACE_SOLVE)
+        {
+            if (segment) segment->print();
+            segment.reset(new SegmentReport(top, r));
+        }
+        else if (segment && r.kind <= TRACE_UNSTORED)
+            segment->add(r);
+    }
+    if (segment) segment->print();
+    return 0;
+}
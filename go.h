@@ -0,0 +1,1640 @@
+#pragma once
+#include "combinatorios.h"
+#include <cstring>
+#include <bitset>
+#include <unordered_map>
+#include <chrono>
+#include <climits>
+#include <map>
+#include <atomic>
+
+// Motor de busqueda de termografos de posiciones de Go. Todo el estado de una busqueda (geometria, reglas y tabla)
+// vive en un Solver, asi que se pueden resolver varias posiciones a la vez, cada una con su Solver.
+
+const int MAX_AREA = 32;
+
+typedef bitset<2*MAX_AREA> Bitset;
+
+// Indices de jugadores: 0 BLACK, 1 WHITE
+enum BoardIntersection {EMPTY = 0, KOBAN = 1, BLACK = 2, WHITE = 3};
+
+const ThermoGraph messyThermograph[2] = { {{vector<Number>(), {Number(500) , BELOW}, true}, {vector<Number>(), {Number(500) , ABOVE}, true}} ,
+                                          {{vector<Number>(), {Number(-500), BELOW}, true}, {vector<Number>(), {Number(-500), ABOVE}, true}}
+                                        };
+
+// Valor de una posicion que no se llego a resolver por falta de presupuesto: esta entre estas dos cotas.
+const Number UNKNOWN_BOUND(1000);
+const ThermoGraph unknownThermograph[2] = { {{vector<Number>(), {Number(-1000), BELOW}, true}, {vector<Number>(), {Number(-1000), ABOVE}, true}} ,
+                                            {{vector<Number>(), {Number( 1000), BELOW}, true}, {vector<Number>(), {Number( 1000), ABOVE}, true}}
+                                          };
+
+typedef unsigned char Index;
+
+const Index OUTER_NULL = 255; // Se usa que sea "todos 1" en binario para memset
+const Index OUTER_WHITE = 254;
+const Index OUTER_BLACK = 253; // Se usa que OUTER_BLACK + 1 == OUTER_WHITE
+
+static_assert(MAX_AREA <= OUTER_NULL && MAX_AREA <= OUTER_BLACK && MAX_AREA <= OUTER_WHITE, "Los indices OUTER_* no pueden ser intersecciones");
+
+struct Board
+{
+    Bitset bs;
+    bool operator==(const Board &o) const { return bs == o.bs; }
+    bool emptyCell(Index pos) const { return bs[1|(int(pos)<<1)] == 0; }
+    bool emptyCellIsKobanned(Index pos) const { return bs[int(pos)<<1] != 0; } // Asumiendo una celda vacia
+    int stoneColor(Index pos) const { return bs[int(pos)<<1];}                 // Asumiendo una celda no vacia (con piedra)
+    BoardIntersection get(Index pos) const { return BoardIntersection((bs[1|(int(pos)<<1)]<<1) | bs[int(pos)<<1]); }
+    void set(Index pos, BoardIntersection value) {
+        bs[1|(int(pos)<<1)] = (value >> 1);
+        bs[int(pos)<<1]     = (value & 1);
+    }
+};
+
+// Board hash function
+namespace std { template <> struct hash<Board> { std::size_t operator()(const Board& b) const { return hash<Bitset>()(b.bs); } }; }
+
+// Dimensiones del tablero y vecinos de cada interseccion (incluyendo los bordes exteriores OUTER_*).
+struct Geometry
+{
+    int boardN, boardM;
+    int totalArea;
+    Index neighbors[MAX_AREA][4];
+};
+
+inline void printPrefix(const string &prefix, const Geometry &geometry, const Board &b, ostream &os = cout)
+{
+    const int boardN = geometry.boardN, boardM = geometry.boardM;
+    os << prefix;
+    os << "/";
+    for (int j=0;j<boardM;j++)
+        os << "-";
+    os << "\\" << endl;
+    for (int i=0;i<boardN;i++)
+    {
+        os << prefix;
+        os << "|";
+        for (int j=0;j<boardM;j++)
+            os << ".KBW"[b.get(Index(i*boardM+j))];
+        os << "|";
+        os << endl;
+    }
+    os << prefix;
+    os << "\\";
+    for (int j=0;j<boardM;j++)
+        os << "-";
+    os << "/" << endl;
+}
+
+inline BoardIntersection charToCell(char c)
+{
+    switch (c)
+    {
+        case 'W':
+            return WHITE;
+        case 'B':
+            return BLACK;
+        case '.':
+            return EMPTY;
+        default:
+            assert(false);
+            break;
+    }
+}
+
+// Lee un tablero en el formato de example.in. Devuelve false (en vez de abortar) si la entrada no es valida.
+inline bool tryReadBoard(istream &is, Geometry &geometry, Board &startingBoard)
+{
+    const int di[4] = {0,0,1,-1};
+    const int dj[4] = {1,-1,0,0};
+    int boardN, boardM;
+    if (!(is >> boardN >> boardM)) return false;
+    if (boardN < 4 || boardM < 4 || boardN > MAX_AREA+2 || boardM > MAX_AREA+2) return false;
+    boardN -= 2;
+    boardM -= 2;
+    if (boardN * boardM > MAX_AREA) return false;
+    geometry.boardN = boardN;
+    geometry.boardM = boardM;
+    geometry.totalArea = boardN * boardM;
+    string board[MAX_AREA+2];
+    for (int i=0;i<boardN+2; i++)
+        if (!(is >> board[i]) || (int)board[i].size() != boardM+2) return false;
+    startingBoard = Board();
+    for (int i=0;i<boardN;i++)
+    for (int j=0;j<boardM;j++)
+    {
+        Index intersectionNumber = Index(boardM * i + j);
+        char c = board[1+i][1+j];
+        if (c != 'W' && c != 'B' && c != '.') return false;
+        startingBoard.set(intersectionNumber, charToCell(c));
+        for (int dir = 0; dir < 4; dir++)
+        {
+            int ni = i + di[dir];
+            int nj = j + dj[dir];
+            Index neighbor;
+            if (ni == -1 || nj == -1 || ni == boardN || nj == boardM)
+            {
+                switch (board[1+ni][1+nj])
+                {
+                    case 'W':
+                        neighbor = OUTER_WHITE;
+                        break;
+                    case 'B':
+                        neighbor = OUTER_BLACK;
+                        break;
+                    case 'X':
+                        neighbor = OUTER_NULL;
+                        break;
+                    default:
+                        return false;
+                }
+            }
+            else
+                neighbor = Index(boardM * ni + nj);
+            geometry.neighbors[intersectionNumber][dir] = neighbor;
+        }
+    }
+    return true;
+}
+
+inline Board readBoard(istream &is, Geometry &geometry)
+{
+    Board startingBoard;
+    bool ok = tryReadBoard(is, geometry, startingBoard);
+    assert(ok);
+    return startingBoard;
+}
+
+// Cambio de una interseccion del tablero (fila y columna desde 0, sin contar el borde).
+struct CellEdit
+{
+    int row, col;
+    BoardIntersection value;
+};
+
+// Aplica los cambios sobre board. Devuelve false (sin modificar board) si alguno cae fuera del tablero o no es EMPTY/BLACK/WHITE.
+inline bool applyEdits(const Geometry &geometry, Board &board, const vector<CellEdit> &edits)
+{
+    Board edited = board;
+    for (const CellEdit &e : edits)
+    {
+        if (e.row < 0 || e.col < 0 || e.row >= geometry.boardN || e.col >= geometry.boardM) return false;
+        if (e.value != EMPTY && e.value != BLACK && e.value != WHITE) return false;
+        edited.set(Index(e.row * geometry.boardM + e.col), e.value);
+    }
+    board = edited;
+    return true;
+}
+
+// Identifica la geometria (dimensiones y bordes): dos tableros con la misma clave comparten posiciones y resultados.
+inline string geometryKey(const Geometry &geometry)
+{
+    string key = to_string(geometry.boardN) + "x" + to_string(geometry.boardM) + ":";
+    for (int i = 0; i < geometry.totalArea; i++)
+        key.append((const char *)geometry.neighbors[i], 4);
+    return key;
+}
+
+inline void printThermographs(ostream &os, const ThermoGraph t[2][2])
+{
+    bool dependsOnKoMonster = (t[0][0] != t[1][0] || t[0][1] != t[1][1]);
+    bool dependsOnMessy     = (t[0][0] != t[0][1] || t[1][0] != t[1][1]);
+    
+    if (dependsOnKoMonster && dependsOnMessy)
+    {
+        os << "LA POSICION DEPENDE DEL KO-MONSTER Y DE UN CICLO LARGO:" << endl;
+        os << "KoMonster | Messy:" << endl;
+        os << "BLACK | BLACK :" << t[0][0] << endl;
+        os << "WHITE | BLACK :" << t[1][0] << endl;
+        os << "BLACK | WHITE :" << t[0][1] << endl;
+        os << "WHITE | WHITE :" << t[1][1] << endl;
+    }
+    else if (dependsOnKoMonster)
+    {
+        os << "LA POSICION DEPENDE DEL KO-MONSTER" << endl;
+        os << "BLACK" << t[0][0] << endl;
+        os << "WHITE" << t[1][0] << endl;
+    }
+    else if (dependsOnMessy)
+    {
+        os << "LA POSICION DEPENDE DE UN CICLO. Si el Messy es:" << endl;
+        os << "BLACK:" << t[0][0] << endl;
+        os << "WHITE:" << t[0][1] << endl;
+    }
+    else
+        os << t[0][0] << endl;
+}
+
+// KO NORMAL:
+// IDEA: Usar la "regla trucha de resolucion de Ko", que da un valor miai super-optimista (seria el valor de un "Absolute Ko Monster").
+//               Notar que se asume que "no hay tableros de 1xN" (mas precisamente, que toda interseccion tiene al menos 2 vecinas).
+
+// CICLOS LARGOS:
+//  Si el juego tiene un ciclo largo (back-edge: Salta como un "processing" en la lookup-table de termografos):
+//       -> Opcion 1: avisa y se cancela todo.
+//       -> Opcion 2: Lo analiza pero marca como "dirty" todos los ancestros hasta la cima de la back-edge, es decir que su resultado no se guarda.
+//                     La opcion 2 tiene bastante sentido. Basicamente a los del ciclo se los recalcula cada vez para poder analizar los "vericuetos"
+//                      particulares de SuperKo para cada uno. Ademas, de alguna manera hay que incorporar en las respuestas (TermoGrafos) la nocion
+//                       de "No Result" que surge al elegir jugar el ciclo.
+//           Plan: Implementar la 1, la 2 ya veremos XD
+
+// Limites para una busqueda: cantidad de nodos expandidos y/o un deadline.
+struct Budget
+{
+    long long maxNodes;
+    chrono::steady_clock::time_point deadline;
+    Budget() : maxNodes(LLONG_MAX), deadline(chrono::steady_clock::time_point::max()) {}
+};
+
+// Resultado de una busqueda con presupuesto. lower y upper son los termografos de juegos <= y >= que la posicion (las
+// posiciones sin resolver se reemplazan por -UNKNOWN_BOUND y +UNKNOWN_BOUND). Como los termografos son monotonos, el
+// mastil verdadero esta entre los dos mastiles. La temperatura no es monotona: las de lower y upper no la acotan, son solo
+// una estimacion.
+struct BoundedThermoGraph
+{
+    ThermoGraph lower, upper;
+    bool exact() const { return !(lower != upper); }
+    Number mastLow() const { return lower.mast(); }
+    Number mastHigh() const { return upper.mast(); }
+    Number temperatureLow() const { return min(lower.temperature(), upper.temperature()); }
+    Number temperatureHigh() const { return max(lower.temperature(), upper.temperature()); }
+    // Los valores reales, incluso los de messyThermograph (en +-500), quedan lejos de +-UNKNOWN_BOUND: un mastil mas alla
+    // de +-750 sale de los reemplazos, y ese lado no esta acotado.
+    static bool bounded(const Number &x) { return Number(-750) < x && x < Number(750); }
+};
+
+// Un lado sin cota se muestra como ?, y la temperatura como estimacion (? si algun lado del mastil no esta acotado).
+inline ostream & operator<<(ostream &os, const BoundedThermoGraph &t)
+{
+    if (t.exact())
+        return os << t.lower;
+    bool low = BoundedThermoGraph::bounded(t.mastLow()), high = BoundedThermoGraph::bounded(t.mastHigh());
+    os << "[";
+    if (low) os << t.mastLow(); else os << "?";
+    os << ", ";
+    if (high) os << t.mastHigh(); else os << "?";
+    os << "](temperatura estimada ";
+    if (!low || !high)
+        os << "?";
+    else if (t.temperatureLow() == t.temperatureHigh())
+        os << t.temperatureLow();
+    else
+        os << "entre " << t.temperatureLow() << " y " << t.temperatureHigh();
+    os << ") SIN TERMINAR";
+    return os;
+}
+
+// Como printThermographs, pero si alguna configuracion no termino se informan las cotas de las cuatro.
+inline void printResults(ostream &os, const BoundedThermoGraph results[2][2])
+{
+    ThermoGraph t[2][2];
+    bool exact = true;
+    for (int koMonster = 0; koMonster < 2; koMonster++)
+    for (int messy = 0; messy < 2; messy++)
+    {
+        t[koMonster][messy] = results[koMonster][messy].lower;
+        exact = exact && results[koMonster][messy].exact();
+    }
+    if (exact)
+    {
+        printThermographs(os, t);
+        return;
+    }
+    os << "BUSQUEDA INCOMPLETA (cotas del mastil, ? si no hay, y temperatura estimada):" << endl;
+    os << "KoMonster | Messy:" << endl;
+    os << "BLACK | BLACK :" << results[0][0] << endl;
+    os << "WHITE | BLACK :" << results[1][0] << endl;
+    os << "BLACK | WHITE :" << results[0][1] << endl;
+    os << "WHITE | WHITE :" << results[1][1] << endl;
+}
+
+// Opciones acumuladas de un jugador. Mientras todas las opciones esten resueltas la cota superior coincide con best;
+// recien cuando aparece una sin resolver se empieza a acumular bestUpper aparte.
+struct OptionFold
+{
+    bool first, split;
+    LineId best, bestUpper;
+    OptionFold() : first(true), split(false), best(0), bestUpper(0) {}
+    LineId upper() const { return split ? bestUpper : best; }
+};
+
+// Tabla de transposicion: tablero -> GraphId. Para areas chicas se indexa directamente por el rango del tablero: cada
+// interseccion es vacia, negra o blanca (un digito en base 3), y aparte se guarda donde esta el koban (hay a lo sumo uno),
+// asi que rank = ternario * (area + 1) + posicion del koban (area si no hay). El arreglo se reserva por paginas a medida
+// que se usan. Para areas mas grandes se usa un unordered_map.
+const int DENSE_MAX_AREA = 12; // 3^12 * 13 entradas de 4 bytes: unos 28MB si se llegaran a tocar todas las paginas
+const int DENSE_PAGE_BITS = 12;
+const GraphId EMPTY_SLOT = ~0u; // Casillero libre del arreglo
+
+struct BoardTable
+{
+    int area = 0;
+    bool dense = false;
+    unordered_map<Board, GraphId> sparse;
+    vector<vector<GraphId> > pages;
+    size_t count = 0;
+    
+    BoardTable() {}
+    explicit BoardTable(int area_) : area(area_), dense(area_ <= DENSE_MAX_AREA)
+    {
+        if (dense)
+        {
+            size_t slots = area + 1;
+            for (int i = 0; i < area; i++) slots *= 3;
+            pages.resize((slots >> DENSE_PAGE_BITS) + 1);
+        }
+    }
+    
+    // Rango de a 4 intersecciones (un byte del bitset) por vez
+    struct ByteRank
+    {
+        unsigned char ternary[256];
+        signed char koban[256];
+        ByteRank()
+        {
+            for (int byte = 0; byte < 256; byte++)
+            {
+                ternary[byte] = 0;
+                koban[byte] = -1;
+                for (int i = 3; i >= 0; i--)
+                {
+                    int val = (byte >> (2*i)) & 3;
+                    if (val == KOBAN) koban[byte] = char(i);
+                    ternary[byte] = (unsigned char)(3 * ternary[byte] + (val >= BLACK ? val - 1 : 0));
+                }
+            }
+        }
+    };
+    
+    size_t rank(const Board &b) const
+    {
+        static const ByteRank table;
+        unsigned long long bits = b.bs.to_ullong();
+        size_t ternary = 0, power = 1;
+        int koban = area;
+        for (int i = 0; i < area; i += 4, bits >>= 8, power *= 81)
+        {
+            unsigned int byte = bits & 255;
+            if (table.koban[byte] >= 0) koban = i + table.koban[byte];
+            ternary += power * table.ternary[byte];
+        }
+        return ternary * (area + 1) + koban;
+    }
+    
+    Board unrank(size_t r) const
+    {
+        Board b;
+        int koban = int(r % (area + 1));
+        r /= area + 1;
+        for (int i = 0; i < area; i++, r /= 3)
+            b.set(Index(i), r % 3 == 0 ? (i == koban ? KOBAN : EMPTY) : BoardIntersection(r % 3 + 1));
+        return b;
+    }
+    
+    // nullptr si el tablero no esta en la tabla
+    const GraphId *find(const Board &b) const
+    {
+        if (!dense)
+        {
+            auto it = sparse.find(b);
+            return it == sparse.end() ? nullptr : &it->second;
+        }
+        size_t r = rank(b);
+        const vector<GraphId> &page = pages[r >> DENSE_PAGE_BITS];
+        if (page.empty()) return nullptr;
+        const GraphId &slot = page[r & ((1 << DENSE_PAGE_BITS) - 1)];
+        return slot == EMPTY_SLOT ? nullptr : &slot;
+    }
+    
+    void set(const Board &b, GraphId t)
+    {
+        assert(t != EMPTY_SLOT);
+        if (!dense)
+        {
+            sparse[b] = t;
+            return;
+        }
+        size_t r = rank(b);
+        vector<GraphId> &page = pages[r >> DENSE_PAGE_BITS];
+        if (page.empty()) page.assign(1 << DENSE_PAGE_BITS, EMPTY_SLOT);
+        GraphId &slot = page[r & ((1 << DENSE_PAGE_BITS) - 1)];
+        if (slot == EMPTY_SLOT) count++;
+        slot = t;
+    }
+    
+    void erase(const Board &b)
+    {
+        if (!dense)
+        {
+            sparse.erase(b);
+            return;
+        }
+        size_t r = rank(b);
+        vector<GraphId> &page = pages[r >> DENSE_PAGE_BITS];
+        if (page.empty()) return;
+        GraphId &slot = page[r & ((1 << DENSE_PAGE_BITS) - 1)];
+        if (slot != EMPTY_SLOT) count--;
+        slot = EMPTY_SLOT;
+    }
+    
+    size_t size() const { return dense ? count : sparse.size(); }
+    
+    size_t memoryBytes() const
+    {
+        size_t bytes = hashTableBytes(sparse) + pages.capacity() * sizeof(vector<GraphId>);
+        for (const vector<GraphId> &page : pages) bytes += page.capacity() * sizeof(GraphId);
+        return bytes;
+    }
+    
+    void clear()
+    {
+        unordered_map<Board, GraphId>().swap(sparse);
+        for (vector<GraphId> &page : pages) vector<GraphId>().swap(page);
+        count = 0;
+    }
+    
+    // f(tablero, GraphId) para cada entrada
+    template <typename F> void forEach(F f) const
+    {
+        if (!dense)
+        {
+            for (const auto &entry : sparse) f(entry.first, entry.second);
+            return;
+        }
+        for (size_t p = 0; p < pages.size(); p++)
+        for (size_t i = 0; i < pages[p].size(); i++)
+            if (pages[p][i] != EMPTY_SLOT)
+                f(unrank((p << DENSE_PAGE_BITS) | i), pages[p][i]);
+    }
+};
+
+// Posiciones del camino de la busqueda en curso (las que en un ciclo se ven como pendientes), con la profundidad y las
+// capturas con que se entro a cada una. Hash abierto con sondeo lineal: el camino es corto y se inserta y borra una
+// posicion por nodo, asi que no conviene pasar por la tabla de resultados ni por el pool.
+struct PathSet
+{
+    struct Entry
+    {
+        Board board;
+        int depth; // 0 si la celda esta libre
+        int captureCount;
+    };
+    vector<Entry> slots = vector<Entry>(64);
+    size_t count = 0;
+    
+    size_t home(const Board &b) const
+    {
+        return size_t((b.bs.to_ullong() * 0x9E3779B97F4A7C15ULL) >> 32) & (slots.size() - 1);
+    }
+    
+    size_t slotOf(const Board &b) const
+    {
+        size_t i = home(b);
+        while (slots[i].depth != 0 && !(slots[i].board == b)) i = (i + 1) & (slots.size() - 1);
+        return i;
+    }
+    
+    // nullptr si el tablero no esta en el camino
+    const Entry *find(const Board &b) const
+    {
+        const Entry &e = slots[slotOf(b)];
+        return e.depth == 0 ? nullptr : &e;
+    }
+    
+    void insert(const Board &b, int depth, int captureCount)
+    {
+        assert(depth > 0);
+        if (2 * (count + 1) > slots.size())
+        {
+            vector<Entry> old(2 * slots.size());
+            old.swap(slots);
+            for (const Entry &e : old)
+                if (e.depth != 0) slots[slotOf(e.board)] = e;
+        }
+        Entry &e = slots[slotOf(b)];
+        if (e.depth == 0) count++;
+        e = Entry{b, depth, captureCount};
+    }
+    
+    void erase(const Board &b)
+    {
+        const size_t mask = slots.size() - 1;
+        size_t i = slotOf(b);
+        if (slots[i].depth == 0) return;
+        count--;
+        // Se corren hacia atras las entradas siguientes que no quedarian alcanzables desde su celda de origen
+        for (size_t j = (i + 1) & mask; slots[j].depth != 0; j = (j + 1) & mask)
+        {
+            size_t k = home(slots[j].board);
+            if (((j - k) & mask) >= ((j - i) & mask))
+            {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i].depth = 0;
+    }
+    
+    void clear()
+    {
+        if (count == 0) return;
+        for (Entry &e : slots) e.depth = 0;
+        count = 0;
+    }
+};
+
+// Tabla de resultados terminados compartida entre procesos (ver go-distributed.h). Vive en un bloque de memoria que arma
+// quien la crea (por ejemplo un mmap compartido): no tiene punteros, solo offsets, y se escribe sin locks. Las lineas se
+// guardan con encodeLine en un arena del mismo bloque. Si se llena, simplemente deja de aceptar resultados.
+struct SharedTable
+{
+    struct Header
+    {
+        unsigned long long slotCount, arenaBytes;
+        atomic<unsigned long long> arenaUsed;
+    };
+    enum SlotState {FREE = 0, WRITING = 1, READY = 2};
+    struct Slot
+    {
+        atomic<unsigned int> state;
+        unsigned int size;
+        unsigned long long key, offset;
+    };
+    static const int MAX_PROBES = 64;
+    
+    Header *header = nullptr;
+    Slot *slots = nullptr;
+    unsigned char *arena = nullptr;
+    
+    static size_t bytesFor(size_t slotCount, size_t arenaBytes) { return sizeof(Header) + slotCount * sizeof(Slot) + arenaBytes; }
+    
+    // Arma la tabla vacia sobre memory (de bytesFor(slotCount, arenaBytes) bytes, inicializada en cero)
+    void create(void *memory, size_t slotCount, size_t arenaBytes)
+    {
+        static_assert(atomic<unsigned int>::is_always_lock_free && atomic<unsigned long long>::is_always_lock_free,
+                      "La tabla compartida necesita atomicos sin locks");
+        header = new (memory) Header;
+        header->slotCount = slotCount;
+        header->arenaBytes = arenaBytes;
+        header->arenaUsed = 0;
+        slots = (Slot *)(header + 1);
+        arena = (unsigned char *)(slots + slotCount);
+    }
+    
+    size_t firstSlot(unsigned long long key) const
+    {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return size_t(key % header->slotCount);
+    }
+    
+    bool find(const Board &b, ThermoGraph &t) const
+    {
+        unsigned long long key = b.bs.to_ullong();
+        size_t i = firstSlot(key);
+        for (int probe = 0; probe < MAX_PROBES; probe++, i = (i + 1) % header->slotCount)
+        {
+            unsigned int state = slots[i].state.load(memory_order_acquire);
+            if (state == FREE) return false;
+            if (state == READY && slots[i].key == key)
+            {
+                const unsigned char *in = decodeLine(arena + slots[i].offset, t.left);
+                decodeLine(in, t.right);
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    void publish(const Board &b, const ThermoGraph &t)
+    {
+        unsigned long long key = b.bs.to_ullong();
+        size_t i = firstSlot(key);
+        for (int probe = 0; probe < MAX_PROBES; probe++, i = (i + 1) % header->slotCount)
+        {
+            unsigned int state = slots[i].state.load(memory_order_acquire);
+            if (state == READY && slots[i].key == key) return;
+            if (state != FREE || !slots[i].state.compare_exchange_strong(state, WRITING)) continue;
+            // Slot tomado. Si el arena no alcanza queda ocupado pero nunca READY: se saltea al buscar.
+            vector<unsigned char> bytes;
+            encodeLine(t.left, bytes);
+            encodeLine(t.right, bytes);
+            unsigned long long offset = header->arenaUsed.fetch_add(bytes.size());
+            if (offset + bytes.size() > header->arenaBytes) return;
+            memcpy(arena + offset, bytes.data(), bytes.size());
+            slots[i].key = key;
+            slots[i].offset = offset;
+            slots[i].size = (unsigned int)bytes.size();
+            slots[i].state.store(READY, memory_order_release);
+            return;
+        }
+    }
+};
+
+// Biblioteca de formas: resultados precalculados (ver go-library.cpp) por geometria y configuracion de reglas. Es un cache
+// de tableros completos: la clave es la geometria entera (dimensiones y bordes, ver geometryKey) y la posicion de todo el
+// tablero, asi que solo la consulta un Solver de esa misma geometria, y no sirve para una region igual dentro de un
+// tablero mas grande (el valor de la region depende de lo que pasa en el resto). Solo guarda entradas que valen desde
+// cualquier camino (ver CYCLIC_ENTRY), asi que consultarla no cambia ningun resultado.
+struct ShapeTable
+{
+    ThermoPool pool;
+    unordered_map<Board, GraphId> entries;
+};
+
+struct ShapeLibrary
+{
+    struct GeometryShapes { ShapeTable tables[2][2]; };
+    map<string, GeometryShapes> geometries;
+    
+    const ShapeTable *find(const Geometry &geometry, int koMonster, int messy) const
+    {
+        auto it = geometries.find(geometryKey(geometry));
+        if (it == geometries.end()) return nullptr;
+        return &it->second.tables[koMonster][messy];
+    }
+    
+    // Formato binario: "MIAILIB1", cantidad de geometrias, y por cada una su geometryKey y las cuatro tablas
+    // (cantidad de entradas, y por cada entrada el tablero y sus dos lineas con encodeLine).
+    void save(ostream &os) const
+    {
+        os.write("MIAILIB1", 8);
+        writeRaw(os, (unsigned int)geometries.size());
+        vector<unsigned char> bytes;
+        for (const auto &g : geometries)
+        {
+            writeRaw(os, (unsigned int)g.first.size());
+            os.write(g.first.data(), g.first.size());
+            for (int koMonster = 0; koMonster < 2; koMonster++)
+            for (int messy = 0; messy < 2; messy++)
+            {
+                const ShapeTable &table = g.second.tables[koMonster][messy];
+                writeRaw(os, (unsigned int)table.entries.size());
+                for (const auto &entry : table.entries)
+                {
+                    ThermoGraph t = table.pool.graph(entry.second);
+                    bytes.clear();
+                    encodeLine(t.left, bytes);
+                    encodeLine(t.right, bytes);
+                    writeRaw(os, (unsigned long long)entry.first.bs.to_ullong());
+                    writeRaw(os, (unsigned int)bytes.size());
+                    os.write((const char *)bytes.data(), bytes.size());
+                }
+            }
+        }
+    }
+    
+    bool load(istream &is)
+    {
+        char magic[8];
+        if (!is.read(magic, 8) || memcmp(magic, "MIAILIB1", 8) != 0) return false;
+        unsigned int geometryCount;
+        if (!readRaw(is, geometryCount)) return false;
+        vector<unsigned char> bytes;
+        for (unsigned int k = 0; k < geometryCount; k++)
+        {
+            unsigned int keySize;
+            if (!readRaw(is, keySize)) return false;
+            string key(keySize, ' ');
+            if (!is.read(&key[0], keySize)) return false;
+            GeometryShapes &shapes = geometries[key];
+            for (int koMonster = 0; koMonster < 2; koMonster++)
+            for (int messy = 0; messy < 2; messy++)
+            {
+                ShapeTable &table = shapes.tables[koMonster][messy];
+                unsigned int count;
+                if (!readRaw(is, count)) return false;
+                for (unsigned int e = 0; e < count; e++)
+                {
+                    unsigned long long bits;
+                    unsigned int size;
+                    if (!readRaw(is, bits) || !readRaw(is, size)) return false;
+                    bytes.resize(size);
+                    if (!is.read((char *)bytes.data(), size)) return false;
+                    ThermoGraph t;
+                    decodeLine(decodeLine(bytes.data(), t.left), t.right);
+                    Board b;
+                    b.bs = Bitset(bits);
+                    table.entries[b] = table.pool.intern(t);
+                }
+            }
+        }
+        return true;
+    }
+    
+    template <typename T> static void writeRaw(ostream &os, const T &x) { os.write((const char *)&x, sizeof(x)); }
+    template <typename T> static bool readRaw(istream &is, T &x) { return bool(is.read((char *)&x, sizeof(x))); }
+};
+
+// Traza de la busqueda: un registro binario de tamanio fijo por posicion visitada, que se escribe cuando la visita termina
+// (asi cada posicion aparece despues de todas las de su subarbol). go-trace.cpp la convierte en reportes de costo por
+// subarbol. Para no tener que decodificar termografos durante la busqueda, los registros guardan el GraphId del resultado,
+// y al terminar cada solve() se agrega un TRACE_SUMMARY con el mastil y la temperatura de cada id que aparecio.
+enum TraceKind : unsigned char
+{
+    TRACE_SOLVE,    // Comienzo de un solve(): board es la posicion inicial, depth y captureCount las dimensiones, player la configuracion
+    TRACE_SUMMARY,  // result es un GraphId, y mast / temperature sus valores
+    TRACE_HIT,      // Estaba en la tabla
+    TRACE_PENDING,  // Estaba pendiente (ciclo)
+    TRACE_LIBRARY,  // Estaba en la biblioteca de formas
+    TRACE_SHARED,   // Estaba en la tabla compartida
+    TRACE_BUDGET,   // Se corto por el presupuesto
+    TRACE_SOLVED,   // Se busco y se guardo el resultado
+    TRACE_UNSTORED  // Se busco, pero el resultado dependia del camino (o era inexacto) y no se guardo
+};
+
+struct TraceRecord
+{
+    unsigned long long board;
+    unsigned long long startNs, durationNs; // Desde el comienzo de la traza
+    long long mastNumerator, temperatureNumerator;
+    unsigned int result;
+    short depth, captureCount;
+    unsigned char kind, player; // player: quien jugo para llegar a la posicion
+    unsigned char mastExp, temperatureExp;
+    signed char move, retake; // Interseccion jugada para llegar a la posicion y la del koban retomado antes, o -1
+};
+
+struct TraceRecorder
+{
+    static const size_t BUFFER_RECORDS = 1 << 14;
+    
+    ostream &os;
+    vector<TraceRecord> buffer;
+    vector<GraphId> results; // Ids que aparecieron desde el ultimo begin(), sin repetir
+    vector<bool> seen; // Indexado por GraphId: esta en results
+    int totalArea = 0; // Del ultimo begin()
+    chrono::steady_clock::time_point origin;
+    
+    explicit TraceRecorder(ostream &os_) : os(os_), origin(chrono::steady_clock::now()) { buffer.reserve(BUFFER_RECORDS); }
+    ~TraceRecorder() { flush(); }
+    
+    unsigned long long now() const { return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - origin).count(); }
+    
+    void write(const TraceRecord &r)
+    {
+        buffer.push_back(r);
+        if (buffer.size() >= BUFFER_RECORDS) flush();
+    }
+    
+    void flush()
+    {
+        os.write((const char *)buffer.data(), streamsize(buffer.size() * sizeof(TraceRecord)));
+        os.flush();
+        buffer.clear();
+    }
+    
+    unsigned long long begin(const Geometry &geometry, const Board &start, int configuration)
+    {
+        TraceRecord r = TraceRecord();
+        r.kind = TRACE_SOLVE;
+        r.board = start.bs.to_ullong();
+        r.depth = short(geometry.boardN);
+        r.captureCount = short(geometry.boardM);
+        r.player = (unsigned char)configuration;
+        r.startNs = now();
+        r.move = r.retake = -1;
+        write(r);
+        totalArea = geometry.totalArea;
+        return r.startNs;
+    }
+    
+    // parent es la posicion desde la que player llego a b (nullptr en la raiz): las intersecciones que pasaron a ser suyas
+    // son la jugada y, si habia un koban, la retoma.
+    void node(const Board &b, const Board *parent, unsigned long long start, int depth, int captureCount, int player, TraceKind kind, GraphId result)
+    {
+        TraceRecord r = TraceRecord();
+        r.kind = kind;
+        r.board = b.bs.to_ullong();
+        r.startNs = start;
+        r.durationNs = now() - start;
+        r.depth = short(depth);
+        r.captureCount = short(captureCount);
+        r.player = (unsigned char)player;
+        r.result = result;
+        r.move = r.retake = -1;
+        // Con retoma pasan a ser suyas dos: el koban y la jugada. Sin retoma, la jugada puede ser sobre el koban.
+        const BoardIntersection stone = BoardIntersection(2 + player);
+        Index played[2];
+        int count = 0;
+        for (Index i = 0; parent != nullptr && i < totalArea; i++)
+            if (parent->get(i) != stone && b.get(i) == stone && count < 2)
+                played[count++] = i;
+        if (count == 2 && parent->get(played[0]) != KOBAN) swap(played[0], played[1]);
+        if (count == 2) r.retake = (signed char)played[0];
+        if (count > 0) r.move = (signed char)played[count - 1];
+        if (result >= seen.size()) seen.resize(max<size_t>(result + 1, 2 * seen.size()), false);
+        if (!seen[result])
+        {
+            seen[result] = true;
+            results.push_back(result);
+        }
+        write(r);
+    }
+    
+    void end(const ThermoPool &pool)
+    {
+        for (GraphId id : results)
+        {
+            ThermoGraph t = pool.graph(id);
+            Number mast = t.mast(), temperature = t.temperature();
+            TraceRecord r = TraceRecord();
+            r.kind = TRACE_SUMMARY;
+            r.result = id;
+            r.mastNumerator = mast.numerator;
+            r.mastExp = (unsigned char)mast.denominatorExp;
+            r.temperatureNumerator = temperature.numerator;
+            r.temperatureExp = (unsigned char)temperature.denominatorExp;
+            write(r);
+            seen[id] = false;
+        }
+        results.clear();
+        flush();
+    }
+};
+
+// Ademas de profundidades, thermograph() devuelve CYCLE_FREE si en la busqueda no se uso ninguna posicion del camino ni se
+// cerro ningun ciclo, y CYCLIC_HIT si se reuso una entrada marcada con CYCLIC_ENTRY: es mayor que cualquier profundidad
+// (no impide guardar el resultado) pero lo marca como dependiente de un ciclo.
+const int CYCLE_FREE = 1000000;
+const int CYCLIC_HIT = CYCLE_FREE - 1;
+const GraphId CYCLIC_ENTRY = 1u << 31;
+
+struct Solver
+{
+    Geometry geometry;
+    int koMonster; // 0 o 1, jugador que es el Absolute Ko Monster
+    int messy; // 0 o 1, jugador que quiere de ser posible anular el juego por ciclo largo
+
+    // Cuestiones de la "transposition table". Los termografos se guardan internados en el pool, y la tabla solo guarda sus ids.
+    // La tabla solo tiene resultados terminados. Las posiciones en curso (pendientes) estan aparte, en path.
+    // Si en el subarbol de una posicion se cerro un ciclo, su valor depende de en que posicion se cerro, y eso del orden
+    // en que se exploro: esas entradas se marcan con CYCLIC_ENTRY y se borran al terminar el solve(). Las demas valen
+    // desde cualquier camino, y se conservan entre llamadas a solve() sin que cambie ningun resultado.
+    ThermoPool pool;
+    BoardTable transpositionTable;
+    PathSet path;
+    vector<Board> cyclicKeys; // Entradas con CYCLIC_ENTRY del solve() en curso
+    const ShapeTable *library = nullptr; // Nivel de solo lectura que se consulta cuando la tabla no tiene la posicion
+    SharedTable *shared = nullptr; // Resultados de otros procesos de la misma busqueda (ver go-distributed.h)
+    atomic<long long> *sharedNodes = nullptr; // Nodos que les quedan a todos los procesos de la busqueda, de a 1024
+    TraceRecorder *trace = nullptr; // Si no es nullptr, se registra cada posicion visitada por la busqueda recursiva
+    // Si no es nullptr, solve() deja ahi memory() al terminar, antes de descartar las entradas con ciclo (que forman parte
+    // de lo que ocupo la busqueda). tableEntriesAtEnd es el tamanio de la tabla en ese momento.
+    MemoryReport *memoryAtEnd = nullptr;
+    size_t tableEntriesAtEnd = 0;
+    TraceKind lastKind; // Como termino la ultima llamada a thermograph(), para la traza
+
+    GraphId messyIds[2], unknownIds[2]; // messyThermograph y unknownThermograph ya internados en el pool
+
+    Solver(const Geometry &geometry_, int koMonster_, int messy_) : geometry(geometry_), koMonster(koMonster_), messy(messy_),
+                                                                            transpositionTable(geometry_.totalArea) { internConstants(); }
+    
+    void internConstants()
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            messyIds[i] = pool.intern(messyThermograph[i]);
+            unknownIds[i] = pool.intern(unknownThermograph[i]);
+        }
+    }
+
+    // Presupuesto de la busqueda en curso
+    Budget budget;
+    long long nodes;
+    bool aborted;
+
+    ThermoGraph solve(const Board &startingBoard)
+    {
+        return solve(startingBoard, Budget()).lower;
+    }
+    
+    // Al agotarse el presupuesto la busqueda termina enseguida: las posiciones sin resolver se acotan y nada inexacto se
+    // guarda en la tabla, asi que una llamada posterior con mas presupuesto retoma desde lo ya resuelto.
+    // Con retrograde se usa antes el motor retrogrado aciclico (ver retrograde()), que en posiciones con ciclos termina
+    // en la busqueda recursiva.
+    BoundedThermoGraph solve(const Board &startingBoard, const Budget &budget_, bool retrograde = false)
+    {
+        budget = budget_;
+        nodes = 0;
+        aborted = false;
+        GraphId result, resultUpper;
+        unsigned long long start = trace != nullptr ? trace->begin(geometry, startingBoard, 2 * koMonster + messy) : 0;
+        lastKind = TRACE_SOLVED;
+        if (retrograde)
+            this->retrograde(result, resultUpper, startingBoard);
+        else
+            thermograph(result, resultUpper, startingBoard);
+        if (trace != nullptr)
+        {
+            trace->node(startingBoard, nullptr, start, 1, 0, 0, lastKind, result);
+            trace->end(pool);
+        }
+        tableEntriesAtEnd = transpositionTable.size();
+        if (memoryAtEnd != nullptr) memory(*memoryAtEnd);
+        forgetCyclic();
+        return BoundedThermoGraph{pool.graph(result), pool.graph(resultUpper)};
+    }
+    
+    // Guardar (o descartar) el resultado de b. Si b estaba en el camino deja de estarlo, como cuando la marca de pendiente
+    // y el resultado compartian la entrada de la tabla. lowestUsed es lo que devolvio la busqueda de b (CYCLE_FREE si no
+    // se cerro ningun ciclo).
+    void store(const Board &b, GraphId t, int lowestUsed)
+    {
+        path.erase(b);
+        if (lowestUsed < CYCLE_FREE)
+        {
+            t |= CYCLIC_ENTRY;
+            cyclicKeys.push_back(b);
+        }
+        transpositionTable.set(b, t);
+    }
+    void discard(const Board &b)
+    {
+        path.erase(b);
+        transpositionTable.erase(b);
+    }
+    void forgetCyclic()
+    {
+        for (const Board &b : cyclicKeys) transpositionTable.erase(b);
+        cyclicKeys.clear();
+    }
+    
+    // Resuelve target como lo haria la busqueda recursiva al llegar a el por steps: las posiciones de steps quedan pendientes
+    // mientras tanto (la i-esima a profundidad i+1). Devuelve la profundidad minima usada, como thermograph(): el resultado
+    // vale desde cualquier camino solo si es CYCLE_FREE. Las entradas con CYCLIC_ENTRY quedan en la tabla hasta el
+    // proximo solve(), para las siguientes llamadas (un resultado que las usa tampoco es CYCLE_FREE).
+    struct PathStep
+    {
+        Board board;
+        int captureCount;
+    };
+    int solveBelow(GraphId &ret, GraphId &upper, const vector<PathStep> &steps, const Board &target, int captureCount, const Budget &budget_)
+    {
+        budget = budget_;
+        nodes = 0;
+        aborted = false;
+        for (size_t i = 0; i < steps.size(); i++)
+            path.insert(steps[i].board, int(i) + 1, steps[i].captureCount);
+        int lowestUsed = thermograph(ret, upper, target, int(steps.size()) + 1, captureCount);
+        path.clear();
+        return lowestUsed;
+    }
+    
+    // Re-resolver despues de editar algunas intersecciones. Entre llamadas la tabla solo conserva entradas que valen desde
+    // cualquier camino (ver CYCLIC_ENTRY), asi que siguen valiendo con el tablero editado: solo se busca de nuevo lo que
+    // cambio, y las posiciones que ya no se alcanzan quedan en la tabla hasta que se la vacie.
+    // Devuelve false, sin tocar board ni buscar nada, si alguna edicion no es valida (ver applyEdits).
+    bool resolve(BoundedThermoGraph &ret, Board &board, const vector<CellEdit> &edits, const Budget &budget_ = Budget())
+    {
+        if (!applyEdits(geometry, board, edits)) return false;
+        ret = solve(board, budget_);
+        return true;
+    }
+    
+    bool outOfBudget()
+    {
+        if (aborted) return true;
+        nodes++;
+        if (nodes > budget.maxNodes || ((nodes & 1023) == 0 && (chrono::steady_clock::now() > budget.deadline
+                                                                || (sharedNodes != nullptr && sharedNodes->fetch_sub(1024) <= 1024))))
+            aborted = true;
+        return aborted;
+    }
+    
+    void useLibrary(const ShapeLibrary &shapes)
+    {
+        library = shapes.find(geometry, koMonster, messy);
+    }
+    
+    // Copia a la biblioteca los resultados terminados de la tabla que no dependen de un ciclo (fuera de un solve() son
+    // todos, ver CYCLIC_ENTRY).
+    void exportTo(ShapeLibrary &shapes) const
+    {
+        ShapeTable &table = shapes.geometries[geometryKey(geometry)].tables[koMonster][messy];
+        transpositionTable.forEach([&](const Board &b, GraphId t)
+        {
+            if ((t & CYCLIC_ENTRY) == 0)
+                table.entries[b] = table.pool.intern(pool.graph(t));
+        });
+    }
+    
+    void clear()
+    {
+        transpositionTable.clear();
+        path.clear();
+        pool.clear();
+        internConstants();
+    }
+    
+    // Memoria propia del Solver (la biblioteca y la SharedTable son de otros)
+    void memory(MemoryReport &r) const
+    {
+        r.add("table", transpositionTable.memoryBytes());
+        r.add("path", path.slots.capacity() * sizeof(PathSet::Entry));
+        pool.memory(r);
+    }
+
+    void fold(OptionFold &f, int player, GraphId option, GraphId optionUpper, int shift);
+    GraphId combine(const OptionFold &black, const OptionFold &white, bool upper);
+    int thermograph(GraphId &ret, GraphId &upper, const Board &board, int depth = 1, int captureCount = 0);
+    template <int MESSY>
+    bool probe(GraphId &ret, GraphId &upper, const Board &board, int captureCount, int &lowestUsed);
+    template <int KO_MONSTER, int MESSY>
+    int thermograph(GraphId &ret, GraphId &upper, const Board &board, const int depth, const int captureCount);
+    void retrograde(GraphId &ret, GraphId &upper, const Board &board);
+    template <int KO_MONSTER, int MESSY>
+    void retrograde(GraphId &ret, GraphId &upper, const Board &start);
+};
+
+// La busqueda esta instanciada para cada configuracion de reglas, asi las comparaciones con KO_MONSTER y MESSY del lazo de
+// jugadas se resuelven al compilar. Se elige la instancia una vez por busqueda.
+inline int Solver::thermograph(GraphId &ret, GraphId &upper, const Board &board, int depth, int captureCount)
+{
+    switch (2 * koMonster + messy)
+    {
+        case 0: return thermograph<0, 0>(ret, upper, board, depth, captureCount);
+        case 1: return thermograph<0, 1>(ret, upper, board, depth, captureCount);
+        case 2: return thermograph<1, 0>(ret, upper, board, depth, captureCount);
+        case 3: return thermograph<1, 1>(ret, upper, board, depth, captureCount);
+        default: assert(false); return 0;
+    }
+}
+
+inline void Solver::retrograde(GraphId &ret, GraphId &upper, const Board &board)
+{
+    switch (2 * koMonster + messy)
+    {
+        case 0: retrograde<0, 0>(ret, upper, board); break;
+        case 1: retrograde<0, 1>(ret, upper, board); break;
+        case 2: retrograde<1, 0>(ret, upper, board); break;
+        case 3: retrograde<1, 1>(ret, upper, board); break;
+        default: assert(false); break;
+    }
+}
+
+// Agrega una opcion de player (ya jugada, con shift puntos de captura) a lo acumulado en f.
+inline void Solver::fold(OptionFold &f, int player, GraphId option, GraphId optionUpper, int shift)
+{
+    LineId line = pool.turn(player == 0 ? pool.right(option) : pool.left(option), shift);
+    LineId lineUpper = line;
+    if (optionUpper != option)
+    {
+        lineUpper = pool.turn(player == 0 ? pool.right(optionUpper) : pool.left(optionUpper), shift);
+        if (!f.split)
+        {
+            f.split = true;
+            f.bestUpper = f.best;
+        }
+    }
+    if (f.first)
+    {
+        f.best = line;
+        f.bestUpper = lineUpper;
+        f.first = false;
+    }
+    else if (player == 0)
+    {
+        f.best = pool.takeMax(f.best, line);
+        if (f.split) f.bestUpper = pool.takeMax(f.bestUpper, lineUpper);
+    }
+    else
+    {
+        f.best = pool.takeMin(f.best, line);
+        if (f.split) f.bestUpper = pool.takeMin(f.bestUpper, lineUpper);
+    }
+}
+
+inline GraphId Solver::combine(const OptionFold &black, const OptionFold &white, bool upper)
+{
+    LineId bestBlack = upper ? black.upper() : black.best;
+    LineId bestWhite = upper ? white.upper() : white.best;
+    if (black.first && white.first)
+        return pool.zero;
+    else if (black.first)
+        return pool.mergeOnlyRight(bestWhite);
+    else if (white.first)
+        return pool.mergeOnlyLeft(bestBlack);
+    else
+        return pool.merge(bestBlack, bestWhite);
+}
+
+// Genera las jugadas legales de board para ambos jugadores (y, si hay un koban, la opcion del KoMonster de retomarlo y
+// jugar otra vez), llamando a visit(player, tablero resultante, capturas con signo) por cada una.
+// Si se genero la retoma del koban devuelve true, y en retaken el tablero con la piedra de ko ya retomada.
+template <int KO_MONSTER, typename Visit>
+bool forEachMove(const Geometry &geometry, Board board, Visit visit, Board &retaken)
+{
+    const int totalArea = geometry.totalArea;
+    const auto &neighbors = geometry.neighbors;
+    bool kobanRetaken = false;
+    
+    // Recolectamos informacion de los grupos libertades etc...
+    
+    Index queue[MAX_AREA]; // Tambien es naturalmente la lista piedras de cada grupo.
+    char groupLiberties[MAX_AREA];
+    Index groupEnd[MAX_AREA];
+    Index groupId[MAX_AREA]; // o groupStart
+    memset(groupId, OUTER_NULL, sizeof(groupId));
+    Index qB = 0, qF = 0;
+    Index kobanpos = OUTER_NULL;
+    for (Index i = 0; i < totalArea; i++)
+    {
+        BoardIntersection val = board.get(i);
+        if (val == KOBAN) kobanpos = i;
+        if (groupId[i] == OUTER_NULL && (val == WHITE || val == BLACK))
+        {
+            Index currentGroup = groupId[i] = qB;
+            groupLiberties[currentGroup] = 0;
+            
+            queue[qB++] = i;
+            while (qF != qB)
+            {
+                Index x = queue[qF++];
+                for (int dir = 0; dir < 4; dir++)
+                {
+                    Index y = neighbors[x][dir];
+                    if (y == OUTER_NULL) continue;
+                    if (y == OUTER_BLACK || y == OUTER_WHITE)
+                    {
+                        if ((val == BLACK && y == OUTER_BLACK) || (y == OUTER_WHITE && val == WHITE))
+                            groupLiberties[currentGroup] = 2; // "+Inf" conceptualmente, pero 2 alcanza y queremos estar lejos de overflow.
+                    }
+                    else
+                    {
+                        BoardIntersection yVal = board.get(y);
+                        if (groupId[y] == OUTER_NULL && yVal == val)
+                        {
+                            groupId[y] = currentGroup;
+                            queue[qB++] = y;
+                        }
+                        else if (groupLiberties[currentGroup] < 2 && (yVal == EMPTY || yVal == KOBAN) && groupId[y] != currentGroup) // Pintamos ficticiamente las libertades con el grupo actual, para no contarlas varias veces.
+                        {
+                            groupLiberties[currentGroup]++;
+                            groupId[y] = currentGroup;
+                        }
+                    }
+                }
+            }
+            groupEnd[currentGroup] = qB;
+        }
+    }
+    
+    // Generamos todas las posiciones vecinas factibles para cada jugador
+    for (int iter = 0; iter < 3; iter++)
+    {
+        int player;
+        if (iter == 2)
+        {
+            if (kobanpos == OUTER_NULL) break;
+            // kobanpos es una opcion de jugada para el KoMonster:
+            // Hacer esa jugada (es facil de procesar a mano porque es solo la captura de la piedra de ko), y luego OTRA jugada en otra interseccion!
+            player = KO_MONSTER;
+            kobanRetaken = true;
+            board.set(kobanpos, BoardIntersection(2+KO_MONSTER));
+            for (int dir = 0; dir < 4; dir++)
+            {
+                Index y = neighbors[kobanpos][dir];
+                if (y < totalArea && board.get(y) == BoardIntersection(2+(!KO_MONSTER)) && groupLiberties[groupId[y]] == 1)
+                {
+                    board.set(y, EMPTY);
+                    break;
+                }
+            }
+            kobanpos = OUTER_NULL;
+        }
+        else
+            player = iter;
+        const int otherPlayer = !player;
+        for (Index i = 0; i < totalArea; i++)
+        {
+            BoardIntersection val = board.get(i);
+            if (val == EMPTY || (val == KOBAN &&  player != KO_MONSTER))
+            {
+                // Hacer jugada alli
+                    //  -- Si tiene un vecino rival con una sola libertad, ese grupo entero fue capturado (hasta 4 y con repetidos). Vaciarlos y contarlos (prisioneros)
+                    //  -- Si no capturo vecinos, verificar que no sea suicido: Una casilla vecina esta vacia, o bien tengo un vecino de mi propio color con 2 libertades.
+                    //  -- Limpiar el KoBan previo que pudiera existir.
+                    //  -- Si se captura exactamente una piedra rival con una piedra solitaria que ahora tiene exactamente una libertad (esa de la captura), ponerle el Ko-ban a esa celda si no somos el KoMonster.
+                int groupCaptures = 0;
+                Index captured[4];
+                
+                for (int dir = 0; dir < 4; dir++)
+                {
+                    Index y = neighbors[i][dir];
+                    if (y < totalArea)
+                    {
+                        if (board.get(y) == BoardIntersection(2+otherPlayer) && groupLiberties[groupId[y]] == 1)
+                        {
+                            for (int j = 0; j < groupCaptures; j++) if (captured[j] == groupId[y]) break;
+                            captured[groupCaptures++] = groupId[y];
+                        }
+                    }
+                }
+                int stonesCaptured = (iter == 2); // Contamos la koban-capture
+                #define capturedDiff (stonesCaptured * (1 - 2*player))
+                if (groupCaptures > 0)
+                {
+                    // Ante capturas, copiamos y sabemos que la jugada es legal sin revisar si hubo suicidio.
+                    Board newBoard = board;
+                    // Realizar capturas
+                    for (int j = 0; j < groupCaptures; j++)
+                    {
+                        stonesCaptured += groupEnd[captured[j]] - captured[j];
+                        for (Index pos = captured[j]; pos < groupEnd[captured[j]]; pos++)
+                            newBoard.set(queue[pos], EMPTY);
+                    }
+                    if (stonesCaptured == 1 && player != KO_MONSTER)
+                    {
+                        // Verificar que sea una piedra solitaria con exactamente una libertad
+                        int stoneLiberties = 0;
+                        Index liberty;
+                        for (int dir = 0; dir < 4; dir++)
+                        {
+                            Index y = neighbors[i][dir];
+                            if (y == OUTER_BLACK + player) goto noKoban;
+                            if (y < totalArea)
+                            {
+                                BoardIntersection yVal = newBoard.get(y);
+                                if (yVal == EMPTY || yVal == KOBAN) {stoneLiberties++; liberty = y;}
+                                else if (yVal == BoardIntersection(2 + player)) goto noKoban;
+                            }
+                        }
+                        if (stoneLiberties == 1)
+                            newBoard.set(liberty, KOBAN);
+                    }
+                    noKoban:;
+                    // Agregar un koban si es necesario
+                    newBoard.set(i,BoardIntersection(2+player));
+                    if (kobanpos != i && kobanpos != OUTER_NULL) newBoard.set(kobanpos, EMPTY);
+                    
+                    visit(player, newBoard, capturedDiff);
+                }
+                else
+                {
+                    // Si no hubo captura, hay que verificar que no se viole la regla de no suicidio.
+                    for (int dir = 0; dir < 4; dir++)
+                    {
+                        Index y = neighbors[i][dir];
+                        if (y < totalArea)
+                        {
+                            if (board.emptyCell(y) || (board.stoneColor(y) == player && groupLiberties[groupId[y]] >= 2))
+                                goto noSuicide;
+                        }
+                        else if (y == OUTER_BLACK + player)
+                            goto noSuicide;
+                    }
+                    continue; // Jugada suicida, no se procesa
+                noSuicide:;
+                    // Estamos ante la jugada tipica: no captura nada y no es suicidio.
+                    board.set(i,BoardIntersection(2+player));
+                    if (kobanpos != i && kobanpos != OUTER_NULL) board.set(kobanpos, EMPTY);
+                    
+                    visit(player, board, capturedDiff);
+                    
+                    if (kobanpos != i && kobanpos != OUTER_NULL) board.set(kobanpos, KOBAN);
+                    board.set(i,val);
+                }
+            }
+        }
+    }
+    #undef capturedDiff
+    if (kobanRetaken) retaken = board;
+    return kobanRetaken;
+}
+
+// Perft: recorre el arbol de jugadas de forEachMove hasta una profundidad fija (sin tabla ni deteccion de ciclos, como el
+// perft de ajedrez) y cuenta las jugadas del ultimo nivel. Sirve de benchmark del generador de jugadas solo, y de oraculo
+// para comparar contra cualquier otra representacion del tablero o generador.
+struct PerftCounts
+{
+    long long nodes = 0;    // Jugadas del ultimo nivel
+    long long captures = 0; // De ellas, las que capturan
+    long long kobans = 0;   // De ellas, las que dejan un koban en el tablero
+    long long retakes = 0;  // Posiciones del nivel anterior donde el KoMonster podia retomar el koban
+};
+
+inline bool hasKoban(const Board &b)
+{
+    // KOBAN es el unico valor con el bit alto en 0 y el bajo en 1
+    const unsigned long long LOW_BITS = 0x5555555555555555ULL;
+    unsigned long long bits = b.bs.to_ullong();
+    return (bits & ~(bits >> 1) & LOW_BITS) != 0;
+}
+
+template <int KO_MONSTER>
+void perft(const Geometry &geometry, const Board &board, int depth, PerftCounts &counts)
+{
+    Board retaken;
+    bool retake = forEachMove<KO_MONSTER>(geometry, board, [&](int, const Board &option, int capturedDiff)
+    {
+        if (depth > 1)
+        {
+            perft<KO_MONSTER>(geometry, option, depth - 1, counts);
+            return;
+        }
+        counts.nodes++;
+        if (capturedDiff != 0) counts.captures++;
+        if (hasKoban(option)) counts.kobans++;
+    }, retaken);
+    if (depth == 1 && retake) counts.retakes++;
+}
+
+inline PerftCounts perft(const Geometry &geometry, int koMonster, const Board &board, int depth)
+{
+    PerftCounts counts;
+    if (koMonster == 0)
+        perft<0>(geometry, board, depth, counts);
+    else
+        perft<1>(geometry, board, depth, counts);
+    return counts;
+}
+
+// Exporta a arena el grafo de jugadas alcanzable desde start como juego combinatorio: cada posicion es un nodo (Left es
+// BLACK), con las jugadas de forEachMove (incluida la retoma del koban), y una jugada que captura vale la posicion
+// resultante mas las capturas (ver GameArena::shift). Solo tiene sentido si el grafo es aciclico.
+template <int KO_MONSTER>
+struct GameExporter
+{
+    const Geometry &geometry;
+    GameArena &arena;
+    size_t maxPositions;
+    unordered_map<Board, GameId> ids;
+    PathSet path;
+    bool ok = true; // false si se encontro un ciclo o mas de maxPositions posiciones
+    bool retake = false; // Se alcanza alguna retoma del koban
+    
+    GameExporter(const Geometry &geometry_, GameArena &arena_, size_t maxPositions_) : geometry(geometry_), arena(arena_), maxPositions(maxPositions_) {}
+    
+    GameId add(const Board &board)
+    {
+        auto it = ids.find(board);
+        if (it != ids.end()) return it->second;
+        if (path.find(board) != nullptr || ids.size() >= maxPositions)
+        {
+            ok = false;
+            return NO_GAME;
+        }
+        path.insert(board, 1, 0);
+        vector<GameId> left, right;
+        Board retaken;
+        if (forEachMove<KO_MONSTER>(geometry, board, [&](int player, const Board &option, int capturedDiff)
+        {
+            if (!ok) return;
+            GameId g = add(option);
+            if (ok) (player == 0 ? left : right).push_back(arena.shift(g, capturedDiff));
+        }, retaken))
+            retake = true;
+        path.erase(board);
+        if (!ok) return NO_GAME;
+        GameId g = arena.add(left, right);
+        ids[board] = g;
+        return g;
+    }
+};
+
+// Devuelve false si desde start se alcanza un ciclo o mas de maxPositions posiciones. retake indica si se alcanza
+// alguna retoma del koban.
+inline bool exportGame(GameArena &arena, GameId &ret, bool &retake, const Geometry &geometry, int koMonster, const Board &start, size_t maxPositions)
+{
+    if (koMonster == 0)
+    {
+        GameExporter<0> exporter(geometry, arena, maxPositions);
+        ret = exporter.add(start);
+        retake = exporter.retake;
+        return exporter.ok;
+    }
+    GameExporter<1> exporter(geometry, arena, maxPositions);
+    ret = exporter.add(start);
+    retake = exporter.retake;
+    return exporter.ok;
+}
+
+// Oraculo para la busqueda: resuelve start con solver y, por separado, evalua el juego exportado con el termografo de
+// GameArena (que no sabe nada de tableros ni de la tabla). En una posicion aciclica los dos tienen que coincidir.
+// Devuelve false si no se pudo exportar; si no, deja los dos termografos en fromBoard y fromGame.
+inline bool crossCheck(Solver &solver, const Board &start, size_t maxPositions, ThermoGraph &fromBoard, ThermoGraph &fromGame, bool &retake)
+{
+    GameArena arena;
+    GameId game;
+    if (!exportGame(arena, game, retake, solver.geometry, solver.koMonster, start, maxPositions)) return false;
+    thermograph(fromGame, arena, game);
+    fromBoard = solver.solve(start);
+    return true;
+}
+
+// Resultado inmediato de board, sin buscar: esta en el camino (ciclo) o ya en la tabla. lowestUsed es lo que devolveria
+// thermograph().
+template <int MESSY>
+bool Solver::probe(GraphId &ret, GraphId &upper, const Board &board, int captureCount, int &lowestUsed)
+{
+    const PathSet::Entry *onPath = path.find(board);
+    if (onPath != nullptr)
+    {
+        int diff = captureCount - onPath->captureCount;
+        if (diff == 0)
+            ret = messyIds[MESSY];
+        else
+            ret = messyIds[diff < 0];
+        upper = ret;
+        lastKind = TRACE_PENDING;
+        lowestUsed = onPath->depth;
+        return true;
+    }
+    const GraphId *known = transpositionTable.find(board);
+    if (known != nullptr)
+    {
+        upper = ret = *known & ~CYCLIC_ENTRY;
+        lastKind = TRACE_HIT;
+        lowestUsed = (*known & CYCLIC_ENTRY) ? CYCLIC_HIT : CYCLE_FREE;
+        return true;
+    }
+    return false;
+}
+
+// Devuelve la profundidad minima utilizada para el computo de este resultado (o CYCLE_FREE / CYCLIC_HIT, ver Solver).
+// upper es una cota superior del resultado; coincide con ret salvo que algo haya quedado sin resolver por el presupuesto.
+template <int KO_MONSTER, int MESSY>
+int Solver::thermograph(GraphId &ret, GraphId &upper, const Board &board, const int depth, const int captureCount)
+{
+    int lowestUsed;
+    if (probe<MESSY>(ret, upper, board, captureCount, lowestUsed))
+        return lowestUsed;
+    if (library != nullptr)
+    {
+        auto shape = library->entries.find(board);
+        if (shape != library->entries.end())
+        {
+            upper = ret = pool.intern(library->pool.graph(shape->second));
+            transpositionTable.set(board, ret);
+            lastKind = TRACE_LIBRARY;
+            return CYCLE_FREE;
+        }
+    }
+    if (shared != nullptr)
+    {
+        ThermoGraph t;
+        if (shared->find(board, t))
+        {
+            upper = ret = pool.intern(t);
+            transpositionTable.set(board, ret);
+            lastKind = TRACE_SHARED;
+            return CYCLE_FREE;
+        }
+    }
+    if (outOfBudget())
+    {
+        ret = unknownIds[0];
+        upper = unknownIds[1];
+        lastKind = TRACE_BUDGET;
+        return CYCLE_FREE;
+    }
+    path.insert(board, depth, captureCount);
+    
+    lowestUsed = CYCLE_FREE;
+    
+    OptionFold black, white;
+    
+    // Cada opcion se resuelve apenas se genera. Generarlas todas antes (para pedir sus celdas de la tabla por adelantado y
+    // combinar primero las ya resueltas) resulto mas lento: la tabla entra en cache en las posiciones que se terminan, y
+    // guardar las opciones cuesta mas que las consultas que se adelantan.
+    Board retaken;
+    forEachMove<KO_MONSTER>(geometry, board, [&](int player, const Board &option, int capturedDiff)
+    {
+        GraphId otg, otgUpper;
+        unsigned long long start = trace != nullptr ? trace->now() : 0;
+        lowestUsed = min(lowestUsed, thermograph<KO_MONSTER, MESSY>(otg, otgUpper, option, depth+1, captureCount + capturedDiff));
+        if (trace != nullptr)
+            trace->node(option, &board, start, depth+1, captureCount + capturedDiff, player, lastKind, otg);
+        fold(player == 0 ? black : white, player, otg, otgUpper, capturedDiff);
+    }, retaken);
+    
+    ret = combine(black, white, false);
+    upper = (black.split || white.split) ? combine(black, white, true) : ret;
+        
+    if (lowestUsed < depth || upper != ret)
+    {
+        discard(board);
+        lastKind = TRACE_UNSTORED;
+    }
+    else
+    {
+        store(board, ret, lowestUsed);
+        // A los otros procesos solo les sirve lo que vale desde cualquier camino
+        if (shared != nullptr && lowestUsed == CYCLE_FREE) shared->publish(board, pool.graph(ret));
+        lastKind = TRACE_SOLVED;
+    }
+    
+    return lowestUsed;
+}
+
+// Motor retrogrado aciclico: recorre en profundidad las posiciones alcanzables desde start (las que ya estan en la tabla o
+// en la biblioteca son hojas) y resuelve cada una al salir de ella, cuando todas sus opciones ya tienen valor: en un grafo
+// sin ciclos el postorden es un orden topologico inverso. Solo se guardan las jugadas de las posiciones en la pila, no el
+// grafo entero. Una posicion que vuelve a una de la pila cierra un ciclo, y ahi se abandona el recorrido: lo que ya salio
+// de la pila no alcanza ningun ciclo (si no, se habria encontrado antes), vale lo mismo desde cualquier camino y quedo en
+// la tabla como entrada sin ciclo. El resto depende del camino (reglas de ko y de ciclos largos) y se resuelve con la
+// busqueda recursiva, que encuentra en la tabla todo lo ya resuelto, asi que el resultado es el mismo que sin retrograde.
+// No hay manejo de componentes fuertemente conexas: en posiciones con ciclos esto es la busqueda recursiva con una
+// primera pasada que adelanta lo que pueda.
+template <int KO_MONSTER, int MESSY>
+void Solver::retrograde(GraphId &ret, GraphId &upper, const Board &start)
+{
+    {
+        struct Move
+        {
+            Board option;
+            unsigned int target;
+            signed char player, capturedDiff;
+        };
+        struct Frame
+        {
+            Board board;
+            unsigned int index, movesBegin, nextMove;
+        };
+        BoardTable ids(geometry.totalArea); // tablero -> indice en value
+        vector<GraphId> value; // EMPTY_SLOT mientras la posicion esta en la pila
+        vector<Frame> stack;
+        vector<Move> moves; // Las jugadas de cada posicion de la pila, contiguas y en el orden de la pila
+        
+        // Agrega b: si es hoja ya tiene su valor, si no se apilan sus jugadas. Devuelve false al agotarse el presupuesto.
+        auto visit = [&](const Board &b) -> bool
+        {
+            unsigned int k = (unsigned int)value.size();
+            ids.set(b, k);
+            const GraphId *known = transpositionTable.find(b);
+            if (known == nullptr && library != nullptr)
+            {
+                auto shape = library->entries.find(b);
+                if (shape != library->entries.end())
+                {
+                    transpositionTable.set(b, pool.intern(library->pool.graph(shape->second)));
+                    known = transpositionTable.find(b);
+                }
+            }
+            // Al empezar el solve() la tabla solo tiene entradas sin ciclo (ver CYCLIC_ENTRY)
+            value.push_back(known != nullptr ? *known : EMPTY_SLOT);
+            if (known != nullptr) return true;
+            if (outOfBudget()) return false;
+            unsigned int begin = (unsigned int)moves.size();
+            Board retaken;
+            forEachMove<KO_MONSTER>(geometry, b, [&](int player, const Board &option, int capturedDiff)
+            {
+                moves.push_back(Move{option, 0, (signed char)player, (signed char)capturedDiff});
+            }, retaken);
+            stack.push_back(Frame{b, k, begin, begin});
+            return true;
+        };
+        
+        bool cycle = false;
+        if (!visit(start))
+        {
+            ret = unknownIds[0];
+            upper = unknownIds[1];
+            return;
+        }
+        while (!stack.empty() && !cycle)
+        {
+            Frame &frame = stack.back();
+            if (frame.nextMove < moves.size())
+            {
+                unsigned int m = frame.nextMove++;
+                const GraphId *id = ids.find(moves[m].option);
+                if (id == nullptr)
+                {
+                    // Copia: visit() agrega jugadas y puede mover el vector
+                    Board option = moves[m].option;
+                    moves[m].target = (unsigned int)value.size();
+                    if (!visit(option))
+                    {
+                        ret = unknownIds[0];
+                        upper = unknownIds[1];
+                        return;
+                    }
+                }
+                else if (value[*id] == EMPTY_SLOT)
+                    cycle = true;
+                else
+                    moves[m].target = *id;
+                continue;
+            }
+            // Todas las opciones resueltas
+            OptionFold black, white;
+            for (unsigned int m = frame.movesBegin; m < moves.size(); m++)
+            {
+                const Move &move = moves[m];
+                fold(move.player == 0 ? black : white, move.player, value[move.target], value[move.target], move.capturedDiff);
+            }
+            value[frame.index] = combine(black, white, false);
+            store(frame.board, value[frame.index], CYCLE_FREE);
+            moves.resize(frame.movesBegin);
+            stack.pop_back();
+        }
+        if (!cycle)
+        {
+            upper = ret = value[0];
+            return;
+        }
+    }
+    thermograph<KO_MONSTER, MESSY>(ret, upper, start, 1, 0);
+}
@@ -1,4 +1,16 @@
 #include "combinatorios.h"
+#include <sstream>
+
+// G + H armado completo, para comparar con GameSum
+GameTree sumTree(const GameTree &g, const GameTree &h)
+{
+    GameTree ret;
+    for (const GameTree &x : g.left)  ret.left .push_back(sumTree(x, h));
+    for (const GameTree &x : h.left)  ret.left .push_back(sumTree(g, x));
+    for (const GameTree &x : g.right) ret.right.push_back(sumTree(x, h));
+    for (const GameTree &x : h.right) ret.right.push_back(sumTree(g, x));
+    return ret;
+}
 
 int main()
 {
@@ -89,5 +101,131 @@ int main()
     thermograph(t,game);
     cout << t << endl;
     
+    GameArena arena;
+    for (const GameTree &g : {zero, one, two, three, four, negfour, twoZero, threeZero, g1, g2, g3, g4, h1, h2, h3, h4, star, game})
+    {
+        ThermoGraph tTree, tArena;
+        thermograph(tTree, g);
+        thermograph(tArena, arena, arena.add(g));
+        assert(!(tTree != tArena));
+    }
+    assert(arena.add(three) == arena.add(GameTree{{two, one, zero}, {}}));
+    
+    for (const GameTree &g : {zero, one, two, three, four, negfour, twoZero, threeZero, g1, g2, g3, g4, h1, h2, h3, h4, star, game})
+    {
+        ThermoGraph tTree, tCanonical;
+        thermograph(tTree, g);
+        canonicalThermograph(tCanonical, g);
+        assert(!(tTree != tCanonical));
+    }
+    GameTree canonicalThree{{GameTree{{one}, {}}}, {}};
+    assert(arena.canonical(arena.add(four)) == arena.add(GameTree{{canonicalThree}, {}}));
+    assert(arena.shift(arena.add(one), 2) == arena.add(canonicalThree));
+    assert(arena.shift(arena.add(zero), -4) == arena.add(negfour));
+    for (const GameTree &g : {star, twoZero, g4, h4, game})
+    for (int n : {-3, -1, 2})
+    {
+        ThermoGraph tShifted;
+        thermograph(t, g);
+        thermograph(tShifted, arena, arena.shift(arena.add(g), n));
+        Number mast = t.mast();
+        mast += Number(n);
+        assert(tShifted.mast() == mast && tShifted.temperature() == t.temperature());
+        assert(arena.equalValue(arena.shift(arena.shift(arena.add(g), n), -n), arena.add(g)));
+    }
+    assert(arena.canonical(arena.add(GameTree{{negone}, {one}})) == arena.add(zero));
+    assert(arena.canonical(arena.add(GameTree{{zero, negone}, {zero}})) == arena.add(star));
+    assert(arena.equalValue(arena.add(GameTree{{star}, {star}}), arena.add(zero)));
+    assert(arena.ge(arena.add(g4), arena.add(g2)));
+    assert(!arena.le(arena.add(star), arena.add(zero)) && !arena.ge(arena.add(star), arena.add(zero)));
+    
+    for (const GameTree &g : {star, twoZero, g2, h4, game})
+    for (const GameTree &h : {one, negtwo, star, g1, h3, game})
+    {
+        ThermoGraph tTree, tSum;
+        thermograph(tTree, sumTree(g, h));
+        sumThermograph(tSum, {g, h});
+        assert(!(tTree != tSum));
+        thermograph(tTree, sumTree(sumTree(g, h), star));
+        sumThermograph(tSum, {star, g, zero, h});
+        assert(!(tTree != tSum));
+    }
+    sumThermograph(t, {star, star});
+    assert(!(t != ZERO_THERMOGRAPH));
+    GameSum sum(arena);
+    sum.thermograph(t, {arena.add(g4), arena.add(three)});
+    ThermoGraph tShifted;
+    thermograph(tShifted, arena, arena.shift(arena.add(g4), 3));
+    assert(!(t != tShifted));
+    
+    istringstream text("4  0 0  1 0 0  2 0 1 0  1 2 1 0");
+    GameId loaded = arena.read(text);
+    assert(loaded == arena.add(GameTree{{two}, {zero}}));
+    thermograph(t, arena, loaded);
+    assert(t.mast() == Number(1));
+    assert(t.temperature() == Number(1));
+    
+    ThermoPool pool;
+    ThermoGraph tg1, tg2, tg4;
+    thermograph(tg1, g1); thermograph(tg2, g2); thermograph(tg4, g4);
+    GraphId id4 = pool.intern(tg4);
+    assert(pool.intern(tg4) == id4);
+    assert(pool.intern(ZERO_THERMOGRAPH) == pool.zero);
+    assert(!(pool.graph(id4) != tg4));
+    ThermoLine direct;
+    takeMax(direct, tg1.left, tg4.left);
+    LineId maxId = pool.takeMax(pool.intern(tg1.left), pool.left(id4));
+    assert(pool.line(maxId) == direct);
+    assert(pool.takeMax(pool.left(id4), pool.intern(tg1.left)) == maxId);
+    ThermoGraph merged;
+    merge(merged, tg2.left, tg4.right);
+    assert(!(pool.graph(pool.merge(pool.intern(tg2.left), pool.right(id4))) != merged));
+    
+    ThermoLine longLine{{}, {Number(-7, 3), BELOW}, false};
+    for (int i = 1; i <= 20; i++) longLine.v.push_back(Number(2*i+1, DenominatorExp(i % 4)));
+    LineId longId = pool.intern(longLine);
+    assert(pool.lines[longId].size == PackedLine::SPILLED);
+    assert(pool.line(longId) == longLine);
+    assert(pool.intern(longLine) == longId);
+    assert(pool.line(pool.left(id4)) == tg4.left);
+    MemoryReport report;
+    pool.memory(report);
+    assert(report.categories.size() == 4 && report.total() >= pool.lines.size() * sizeof(PackedLine) + longLine.v.size());
+    assert(pool.averageLineLength() > 0);
+    
+    GameTree wide{{g1, g2, g3, g4, twoZero}, {h1, h2, h3, h4, negtwoZero}};
+    GameTree wider{{wide, GameTree{{wide}, {h2}}, g4}, {GameTree{{g3}, {wide}}, wide, h1}};
+    ThermoGraph sequential, parallel;
+    thermograph(sequential, wider);
+    parallelThermograph(parallel, wider, 8, 4);
+    assert(!(parallel != sequential));
+    assert(gameSize(wide, 1000) == 1 + gameSize(g1, 1000) + gameSize(g2, 1000) + gameSize(g3, 1000) + gameSize(g4, 1000) + gameSize(twoZero, 1000)
+                                     + gameSize(h1, 1000) + gameSize(h2, 1000) + gameSize(h3, 1000) + gameSize(h4, 1000) + gameSize(negtwoZero, 1000));
+    assert(gameSize(wider, 10) == 10);
+    
+    thermograph(t, twoZero);
+    ThermoGraphIndex index(t);
+    assert(index.mast == Number(1) && index.temperature == Number(1));
+    assert(index.wall(Number(1, 1)) == make_pair(Number(3, 1), Number(1, 1)));
+    assert(index.width(Number(1, 1)) == Number(1));
+    assert(index.width(Number(5)) == ZERO);
+    vector<ThermoGraphIndex> indexes;
+    for (const GameTree &g : {zero, three, twoZero, threeZero, g1, g2, g3, g4, h1, h2, h3, h4, game, wide, wider})
+    {
+        thermograph(t, g);
+        indexes.push_back(ThermoGraphIndex(t));
+        assert(indexes.back().mast == t.mast());
+        assert(indexes.back().wall(INF) == make_pair(t.mast(), t.mast()));
+        assert(indexes.back().wall(ZERO) == make_pair(t.left.base.x, t.right.base.x));
+    }
+    vector<const ThermoGraphIndex *> graphs;
+    for (const ThermoGraphIndex &i : indexes) graphs.push_back(&i);
+    vector<Number> temperatures{Number(3), ZERO, Number(1, 2), Number(1), Number(7, 2), Number(3, 1), Number(2)};
+    vector<pair<Number, Number> > batch;
+    walls(batch, graphs, temperatures);
+    for (size_t g = 0; g < graphs.size(); g++)
+    for (size_t j = 0; j < temperatures.size(); j++)
+        assert(batch[g * temperatures.size() + j] == graphs[g]->wall(temperatures[j]));
+    
     return 0;
 }
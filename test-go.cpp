@@ -0,0 +1,180 @@
+#include "go.h"
+#include <map>
+#include <random>
+#include <sstream>
+
+// Tablero de area intersecciones con los digitos ternarios de ternary (0 vacia, 1 negra, 2 blanca) y el koban en la
+// interseccion koban (area si no hay)
+Board ternaryBoard(int area, size_t ternary, int koban)
+{
+    Board b;
+    for (int i = 0; i < area; i++, ternary /= 3)
+        b.set(Index(i), ternary % 3 == 0 ? (i == koban ? KOBAN : EMPTY) : BoardIntersection(ternary % 3 + 1));
+    return b;
+}
+
+Board keyBoard(unsigned long long key)
+{
+    Board b;
+    b.bs = Bitset(key);
+    return b;
+}
+
+int main()
+{
+    // BoardTable: rank y unrank son inversos sobre todos los tableros de cada area chica (el koban solo puede estar en una
+    // interseccion vacia), y el rango es el indice denso ternario * (area + 1) + koban.
+    for (int area = 1; area <= 9; area++)
+    {
+        BoardTable table(area);
+        assert(table.dense);
+        size_t boards = 1;
+        for (int i = 0; i < area; i++) boards *= 3;
+        for (size_t ternary = 0; ternary < boards; ternary++)
+        {
+            size_t digits = ternary;
+            for (int koban = 0; koban <= area; koban++, digits /= 3)
+            {
+                if (koban < area && digits % 3 != 0) continue;
+                Board b = ternaryBoard(area, ternary, koban);
+                size_t r = table.rank(b);
+                assert(r == ternary * (area + 1) + koban);
+                assert(table.unrank(r) == b);
+            }
+        }
+    }
+
+    // Por la tabla: cada tablero de area 5 con su propio id, y forEach devuelve exactamente esos
+    {
+        const int area = 5;
+        BoardTable table(area);
+        map<size_t, GraphId> expected;
+        for (size_t ternary = 0; ternary < 243; ternary++)
+        for (int koban = 0; koban <= area; koban++)
+        {
+            Board b = ternaryBoard(area, ternary, koban);
+            if (koban < area && b.get(Index(koban)) != KOBAN) continue;
+            GraphId id = GraphId(expected.size());
+            table.set(b, id);
+            expected[table.rank(b)] = id;
+        }
+        assert(table.size() == expected.size());
+        size_t visited = 0;
+        table.forEach([&](const Board &b, GraphId t)
+        {
+            assert(expected.at(table.rank(b)) == t);
+            assert(*table.find(b) == t);
+            visited++;
+        });
+        assert(visited == expected.size());
+    }
+
+    // PathSet: tableros que caen en la misma celda de origen forman una cadena de sondeo. Al borrar uno del medio, los
+    // siguientes se corren hacia atras y se siguen encontrando (con su profundidad y capturas).
+    {
+        PathSet path;
+        const size_t home = path.home(keyBoard(1));
+        vector<Board> chain;
+        for (unsigned long long key = 1; chain.size() < 6; key++)
+            if (path.home(keyBoard(key)) == home)
+                chain.push_back(keyBoard(key));
+        // Uno de la celda siguiente, que queda al final de la cadena y tampoco puede perderse
+        Board neighbor;
+        for (unsigned long long key = 1; ; key++)
+            if (path.home(keyBoard(key)) == ((home + 1) & (path.slots.size() - 1)))
+            {
+                neighbor = keyBoard(key);
+                break;
+            }
+        for (size_t i = 0; i < chain.size(); i++)
+            path.insert(chain[i], int(i) + 1, int(i) * 10);
+        path.insert(neighbor, 100, -1);
+        assert(path.count == chain.size() + 1);
+
+        path.erase(chain[2]);
+        assert(path.find(chain[2]) == nullptr);
+        path.erase(chain[0]);
+        assert(path.find(chain[0]) == nullptr);
+        for (size_t i = 0; i < chain.size(); i++)
+        {
+            if (i == 0 || i == 2) continue;
+            const PathSet::Entry *e = path.find(chain[i]);
+            assert(e != nullptr && e->depth == int(i) + 1 && e->captureCount == int(i) * 10);
+        }
+        assert(path.find(neighbor) != nullptr && path.find(neighbor)->depth == 100);
+        assert(path.count == chain.size() - 1);
+
+        // Borrar algo que no esta, o dos veces, no cambia nada
+        path.erase(chain[2]);
+        assert(path.count == chain.size() - 1);
+        path.insert(chain[2], 7, 7);
+        assert(path.find(chain[2])->depth == 7);
+        path.clear();
+        for (const Board &b : chain) assert(path.find(b) == nullptr);
+        assert(path.find(neighbor) == nullptr);
+    }
+
+    // PathSet contra un map, con pocas claves distintas (muchas colisiones y re-inserciones) y creciendo de tamanio
+    {
+        PathSet path;
+        map<unsigned long long, pair<int, int> > reference;
+        mt19937_64 rng(1);
+        for (int step = 0; step < 200000; step++)
+        {
+            unsigned long long key = rng() % 300;
+            Board b = keyBoard(key);
+            if (rng() % 3 == 0)
+            {
+                path.erase(b);
+                reference.erase(key);
+            }
+            else
+            {
+                int depth = 1 + int(rng() % 50), captures = int(rng() % 7) - 3;
+                path.insert(b, depth, captures);
+                reference[key] = make_pair(depth, captures);
+            }
+            assert(path.count == reference.size());
+            if (step % 1000 == 0)
+                for (unsigned long long k = 0; k < 300; k++)
+                {
+                    const PathSet::Entry *e = path.find(keyBoard(k));
+                    auto it = reference.find(k);
+                    assert((e == nullptr) == (it == reference.end()));
+                    if (e != nullptr) assert(e->depth == it->second.first && e->captureCount == it->second.second);
+                }
+        }
+    }
+
+    // Motor retrogrado aciclico contra la busqueda recursiva, en las cuatro configuraciones. Las dos primeras posiciones no
+    // tienen ciclos (la segunda tiene un ko, que el koban vuelve aciclico) y se resuelven enteras de abajo hacia arriba; las
+    // otras dos si, y ahi retrograde abandona al primer ciclo y sigue con la busqueda recursiva.
+    {
+        const char *positions[] = {
+            "4 5\nXBBBX\nB.B.W\nBW.WW\nXWWWX\n",
+            "4 6\nXBBWWX\nB.BW.W\nBB.BWW\nXBBWWX\n",
+            "4 5\nXXBBX\nWBW.W\nW...W\nXWWWX\n",
+            "5 4\nXXXX\nB..X\nBB.W\nX..W\nXXXX\n",
+        };
+        const bool cyclic[] = {false, false, true, true};
+        for (int p = 0; p < 4; p++)
+        {
+            istringstream is(positions[p]);
+            Geometry geometry;
+            Board board = readBoard(is, geometry);
+            for (int koMonster = 0; koMonster < 2; koMonster++)
+            for (int messy = 0; messy < 2; messy++)
+            {
+                Solver recursive(geometry, koMonster, messy), bottomUp(geometry, koMonster, messy), oracle(geometry, koMonster, messy);
+                ThermoGraph fromBoard, fromGame;
+                bool retake;
+                assert(crossCheck(oracle, board, 1 << 16, fromBoard, fromGame, retake) == !cyclic[p]);
+                ThermoGraph expected = recursive.solve(board);
+                BoundedThermoGraph result = bottomUp.solve(board, Budget(), true);
+                assert(result.exact() && !(result.lower != expected));
+            }
+        }
+    }
+
+    return 0;
+}